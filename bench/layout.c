@@ -0,0 +1,190 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "config.h"
+#include "engine.h"
+#include "exact.h"
+#include "grid.h"
+#include "rng.h"
+
+/* porovnanie layoutov tabuľky susedov na veľkom svete:
+   engine bez orezávania (chodia všetky políčka) a DP prechody, s počítadlami cache a TLB
+   použitie: bench_layout [strana_sveta [K [hustota_prekážok]]] */
+
+/* sledované udalosti (ak ich jadro sprístupní) */
+static const struct {
+        const char *name;
+        uint32_t type;
+        uint64_t config;
+} bench_events[] = {
+        {"cache-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {"L1d-miss", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {"dTLB-miss", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+                (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+#define BENCH_EVENTS (int)(sizeof(bench_events) / sizeof(bench_events[0]))
+
+typedef struct {
+        int fd[BENCH_EVENTS];
+        struct timespec start;
+} bench_counters_t;
+
+/* počítadlá pre tento proces a všetky jeho vlákna (-1 = nedostupné) */
+static void counters_start(bench_counters_t *c)
+{
+        for (int e = 0; e < BENCH_EVENTS; e++) {
+                struct perf_event_attr a;
+                memset(&a, 0, sizeof(a));
+                a.size = sizeof(a);
+                a.type = bench_events[e].type;
+                a.config = bench_events[e].config;
+                a.exclude_kernel = 1;
+                a.exclude_hv = 1;
+                a.inherit = 1;
+                c->fd[e] = (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &c->start);
+}
+
+/* vypíše čas a počty udalostí */
+static void counters_stop(bench_counters_t *c, const char *what, const char *layout)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double sec = (double)(now.tv_sec - c->start.tv_sec) + (double)(now.tv_nsec - c->start.tv_nsec) * 1e-9;
+
+        printf("%-7s %-7s %8.3f s", what, layout, sec);
+        for (int e = 0; e < BENCH_EVENTS; e++) {
+                uint64_t v = 0;
+                if (c->fd[e] >= 0 && read(c->fd[e], &v, sizeof(v)) == (ssize_t)sizeof(v))
+                        printf("  %s=%llu", bench_events[e].name, (unsigned long long)v);
+                else
+                        printf("  %s=n/a", bench_events[e].name);
+                if (c->fd[e] >= 0)
+                        close(c->fd[e]);
+        }
+        printf("\n");
+        fflush(stdout);
+}
+
+static const char *layout_name(int layout)
+{
+        switch (layout) {
+        case GRID_LAYOUT_TILED:
+                return "tiled";
+        case GRID_LAYOUT_MORTON:
+                return "morton";
+        default:
+                return "rows";
+        }
+}
+
+int main(int argc, char **argv)
+{
+        int side = (argc > 1) ? atoi(argv[1]) : 4001;
+        uint32_t k = (argc > 2) ? (uint32_t)atoi(argv[2]) : 64;
+        double density = (argc > 3) ? atof(argv[3]) : 0.1;
+
+        if (side <= 0 || side % 2 == 0 || (uint64_t)side * (uint64_t)side > GRID_MAX_CELLS || k == 0) {
+                fprintf(stderr, "usage: %s [odd side [K [density]]]\n", argv[0]);
+                return 1;
+        }
+
+        config cfg;
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.start_type = SIM_NEW;
+        cfg.mode = SIM_MODE_SUMMARY;
+        cfg.world_type = density > 0.0 ? WORLD_OBSTACLES : WORLD_EMPTY;
+        cfg.obstacle_density = density;
+        cfg.world_width = side;
+        cfg.world_height = side;
+        cfg.replications = 1;
+        cfg.max_steps = k;
+        cfg.seed = 12345;
+        cfg.probs = (probabilities_t){0.25, 0.25, 0.25, 0.25};
+
+        size_t total = grid_cells(&cfg);
+
+        /* prekážky nemusia nechať svet priechodný, chodcom to nevadí */
+        uint64_t *obstacles = NULL;
+        if (cfg.world_type == WORLD_OBSTACLES) {
+                obstacles = bitmap_alloc(total);
+                if (!obstacles)
+                        return 1;
+                rng_t rng;
+                rng_init(&rng, cfg.seed, 0, 0);
+                size_t origin = (size_t)grid_idx_of(&cfg, 0, 0);
+                for (size_t i = 0; i < total; i++)
+                        if (i != origin && rng_next01(&rng) < density)
+                                bitmap_set(obstacles, i);
+        }
+
+        uint64_t *hits = malloc(total * sizeof(uint64_t));
+        uint64_t *steps_sum = malloc(total * sizeof(uint64_t));
+        uint32_t *reps_used = malloc(total * sizeof(uint32_t));
+        msg_sum_cell_t *summary = malloc(total * sizeof(msg_sum_cell_t));
+        if (!hits || !steps_sum || !reps_used || !summary)
+                return 1;
+
+        printf("world %dx%d (%zu cells), K=%u, density=%.2f, exact sweeps=%u\n",
+                side, side, total, (unsigned)k, density, (unsigned)(k / 4));
+
+        for (int layout = GRID_LAYOUT_ROWS; layout <= GRID_LAYOUT_MORTON; layout++) {
+                cfg.layout = layout;
+
+                grid_nbr_t nbr;
+                if (grid_nbr_build(&nbr, &cfg, obstacles) != 0) {
+                        fprintf(stderr, "out of memory\n");
+                        return 1;
+                }
+
+                /* všetky políčka chodia celých K krokov (bez dist), aby išli cez celý svet */
+                engine_job_t job;
+                memset(&job, 0, sizeof(job));
+                job.cfg = &cfg;
+                job.obstacles = obstacles;
+                job.nbr = &nbr;
+                job.seed = cfg.seed;
+
+                memset(hits, 0, total * sizeof(uint64_t));
+                memset(steps_sum, 0, total * sizeof(uint64_t));
+                memset(reps_used, 0, total * sizeof(uint32_t));
+
+                bench_counters_t c;
+                counters_start(&c);
+                if (engine_run(&job, hits, steps_sum, reps_used) != 0)
+                        return 1;
+                counters_stop(&c, "engine", layout_name(layout));
+
+                /* kontrola, že layout nezmenil výsledok */
+                uint64_t sum = 0;
+                for (size_t i = 0; i < total; i++)
+                        sum += hits[i] * (i + 1) + steps_sum[i];
+                printf("        check=%016llx\n", (unsigned long long)sum);
+
+                config ex = cfg;
+                ex.max_steps = k / 4 ? k / 4 : 1;
+                counters_start(&c);
+                if (exact_run(&ex, obstacles, &nbr, summary) != 0)
+                        return 1;
+                counters_stop(&c, "exact", layout_name(layout));
+
+                grid_nbr_free(&nbr);
+        }
+
+        free(hits);
+        free(steps_sum);
+        free(reps_used);
+        free(summary);
+        free(obstacles);
+        return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* bitová mapa: 1 bit na políčko, bit i je v slove i / 64 (prekážky) */
+
+/* počet 64-bitových slov pre n bitov */
+static inline size_t bitmap_words(size_t n)
+{
+        return (n + 63) / 64;
+}
+
+/* veľkosť mapy v bajtoch (aj na sieti a pri ukladaní) */
+static inline size_t bitmap_bytes(size_t n)
+{
+        return bitmap_words(n) * sizeof(uint64_t);
+}
+
+/* vynulovaná mapa pre n bitov */
+static inline uint64_t *bitmap_alloc(size_t n)
+{
+        return calloc(bitmap_words(n), sizeof(uint64_t));
+}
+
+static inline int bitmap_get(const uint64_t *b, size_t i)
+{
+        return (int)((b[i >> 6] >> (i & 63)) & 1u);
+}
+
+static inline void bitmap_set(uint64_t *b, size_t i)
+{
+        b[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+/* počet nastavených bitov */
+static inline size_t bitmap_count(const uint64_t *b, size_t n)
+{
+        size_t c = 0;
+        for (size_t w = 0; w < bitmap_words(n); w++)
+                c += (size_t)__builtin_popcountll(b[w]);
+        return c;
+}
+
+#endif
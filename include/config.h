@@ -5,14 +5,16 @@
 
 /* typ spustenia simulácie */
 typedef enum {
-    SIM_NEW  = 1,
-    SIM_LOAD = 2
+    SIM_NEW    = 1,
+    SIM_LOAD   = 2,
+    SIM_RESUME = 3      /* pokračovanie z checkpointu v input_file */
 } sim_start_type_t;
 
 /* režim simulácie */
 typedef enum {
     SIM_MODE_INTERACTIVE = 1,
-    SIM_MODE_SUMMARY     = 2
+    SIM_MODE_SUMMARY     = 2,
+    SIM_MODE_EXACT       = 3    /* presný výpočet (DP) namiesto Monte Carlo */
 } sim_mode_t;
 
 /* typ sveta */
@@ -21,6 +23,13 @@ typedef enum {
     WORLD_OBSTACLES = 2
 } world_type_t;
 
+/* poradie políčok v pamäti výpočtu (klientom a do súboru ide vždy po riadkoch) */
+typedef enum {
+    GRID_LAYOUT_ROWS   = 0,
+    GRID_LAYOUT_TILED  = 1,     /* dlaždice 8x8, v dlaždici po riadkoch */
+    GRID_LAYOUT_MORTON = 2      /* Z-poradie (prekladané bity x a y) */
+} grid_layout_t;
+
 /* pravdepodobnosti pohybu */
 typedef struct {
     double p_up;
@@ -42,6 +51,29 @@ typedef struct {
     uint32_t replications;
     uint32_t max_steps;
 
+    int threads;            /* počet výpočtových vlákien, 0 = podľa CPU */
+    int workers;            /* 0 = výpočet v procese servera, N = N procesov s rozsahmi replikácií */
+    uint64_t seed;          /* seed generátora, 0 = náhodný */
+    uint32_t first_rep;     /* index prvej replikácie; behy s rovnakým seedom a nadväzujúcimi
+                               rozsahmi replikácií sa dajú spojiť (merge) */
+
+    /* adaptívny počet replikácií: políčko končí, keď je 95 % interval užší ako tolerancia */
+    int adaptive;
+    double ci_tolerance;    /* pre pravdepodobnosť absolútna, pre priemer krokov relatívna */
+    uint32_t deadline_sec;  /* 0 = bez limitu, inak vráti najlepší odhad po uplynutí času */
+
+    int jump;               /* 1 = ďaleko od cieľa a prekážok skáče o 4..32 krokov naraz */
+    uint32_t hist_width;    /* 0 = bez histogramu, inak šírka koša časov príchodu v krokoch */
+    int layout;             /* grid_layout_t, výsledky nemení */
+
+    /* priebežné summary počas výpočtu (0 = vypnuté), stačí splniť jedno z nich */
+    uint32_t snapshot_reps; /* každých N replikácií */
+    uint32_t snapshot_ms;   /* alebo každých T milisekúnd */
+
+    /* checkpoint rozbehnutého výpočtu (0 = vypnutý), zapisuje sa na pozadí */
+    uint32_t checkpoint_sec;
+    char checkpoint_file[256];
+
     probabilities_t probs;
 
     char input_file[256];
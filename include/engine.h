@@ -0,0 +1,55 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "grid.h"
+#include "fpt.h"
+
+/* stav výpočtu medzi dávkami (checkpoint a pokračovanie) */
+typedef struct {
+        uint32_t reps_done;     /* dokončené replikácie, ďalšia dávka začína tu */
+        uint64_t *hits;         /* w*h prvkov */
+        uint64_t *steps_sum;
+        uint32_t *reps_used;
+        double *welford;        /* 4 na políčko: priemer a M2 zásahu, priemer a M2 krokov
+                                   (NULL mimo adaptívneho režimu) */
+        uint8_t *retired;       /* 1 = políčko už nebeží (NULL mimo adaptívneho režimu) */
+} engine_state_t;
+
+/* zadanie pre Monte Carlo výpočet summary */
+typedef struct {
+        const config *cfg;
+        const uint64_t *obstacles;  /* bitová mapa po riadkoch, NULL pri prázdnom svete */
+        const grid_nbr_t *nbr;      /* tabuľka susedov toho istého sveta (určuje layout) */
+        const uint32_t *dist;       /* vzdialenosti do [0,0] v poradí tabuľky (NULL = bez orezávania) */
+        fpt_hist_t *hist;           /* po riadkoch, NULL = bez histogramu časov príchodu */
+        uint64_t seed;
+        int threads;                /* <= 0 -> podľa počtu CPU */
+
+        /* voliteľné: zavolá sa po každej dokončenej dávke replikácií */
+        void (*on_batch)(void *user, uint32_t reps_done, uint64_t cells_active);
+
+        /* voliteľné: priebežný stav podľa cfg->snapshot_reps / snapshot_ms (nie po poslednej dávke);
+           polia sú v poradí tabuľky nbr a platia len počas volania */
+        void (*on_snapshot)(void *user, const uint64_t *hits, const uint64_t *steps_sum,
+                            const uint32_t *reps_used, uint32_t reps_done, uint64_t cells_active);
+
+        /* voliteľné: stav na checkpoint každých cfg->checkpoint_sec sekúnd (nie po poslednej dávke);
+           polia sú v poradí tabuľky nbr a platia len počas volania, takže ich treba rýchlo skopírovať */
+        void (*on_checkpoint)(void *user, const engine_state_t *st);
+
+        /* voliteľné: pokračovanie z checkpointu (polia po riadkoch, histogram musí byť už naplnený);
+           prúdy chodcov závisia len od seedu, replikácie a políčka, takže stačí reps_done */
+        const engine_state_t *resume;
+        void *user;
+} engine_job_t;
+
+/* spustí replikácie pre všetky políčka;
+   hits a steps_sum majú w*h prvkov a musia byť vynulované (výsledky sú po riadkoch,
+   počas výpočtu slúžia ako pracovné polia v poradí tabuľky),
+   reps_used[i] = koľko replikácií políčko naozaj dostalo (adaptívny režim / deadline) */
+int engine_run(const engine_job_t *job, uint64_t *hits, uint64_t *steps_sum, uint32_t *reps_used);
+
+#endif
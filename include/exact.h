@@ -0,0 +1,15 @@
+#ifndef EXACT_H
+#define EXACT_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "protocol.h"
+#include "grid.h"
+
+/* presný výpočet P(zásah [0,0] do K krokov) a E[kroky | zásah] pre všetky políčka
+   (K prechodov 5-bodovým stencilom v poradí tabuľky nbr); obstacles aj summary sú po riadkoch,
+   summary má w*h prvkov v poradí ako posiela server */
+int exact_run(const config *cfg, const uint64_t *obstacles, const grid_nbr_t *nbr, msg_sum_cell_t *summary);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef FPT_H
+#define FPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+/* histogram časov prvého príchodu do [0,0]:
+   koš b obsahuje zásahy v krokoch (b * width, (b + 1) * width] */
+typedef struct {
+        uint32_t width;         /* šírka koša v krokoch (1 = presne po krokoch) */
+        uint32_t buckets;       /* ceil(max_steps / width) */
+        uint32_t cells;
+        uint32_t max_steps;     /* K behu, pre ktorý histogram platí */
+        uint32_t origin;        /* index [0,0] */
+        uint32_t *reps;         /* replikácie na políčko */
+        uint32_t *hits;         /* hits[cell * buckets + b] */
+        uint64_t *steps;        /* súčet krokov zásahov v koši */
+} fpt_hist_t;
+
+/* vynulovaný histogram pre cells políčok */
+int fpt_alloc(fpt_hist_t *h, uint32_t cells, uint32_t origin, uint32_t max_steps, uint32_t width);
+
+/* uvoľní polia */
+void fpt_free(fpt_hist_t *h);
+
+/* index koša pre krok zásahu (1..max_steps) */
+static inline uint32_t fpt_bucket(const fpt_hist_t *h, uint32_t step)
+{
+        return (step - 1) / h->width;
+}
+
+/* horizont zaokrúhlený nadol na koniec koša (najmenej prvý koš) */
+uint32_t fpt_horizon(const fpt_hist_t *h, uint32_t k);
+
+/* summary pre horizont k <= max_steps (k sa zarovná cez fpt_horizon),
+   rovnaké hodnoty ako beh s max_steps = k */
+void fpt_summary(const fpt_hist_t *h, uint32_t k, msg_sum_cell_t *out);
+
+/* histogram v tvare správy MSG_FPT_HIST (malloc), *len = veľkosť */
+void *fpt_encode(const fpt_hist_t *h, size_t *len);
+
+/* rozbalí správu MSG_FPT_HIST; 0 ok, -1 pri zlej veľkosti alebo pamäti */
+int fpt_decode(fpt_hist_t *h, const void *buf, size_t len);
+
+#endif
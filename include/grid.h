@@ -0,0 +1,126 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "bitmap.h"
+
+/* smery v tabuľke susedov */
+enum {
+        GRID_UP    = 0,
+        GRID_DOWN  = 1,
+        GRID_LEFT  = 2,
+        GRID_RIGHT = 3
+};
+
+/* indexy políčok sú 32-bitové (tabuľka susedov, chodci), veľkosti polí sú size_t */
+#define GRID_MAX_CELLS ((uint64_t)INT32_MAX)
+
+/* počet políčok sveta bez pretečenia int */
+static inline size_t grid_cells(const config *cfg)
+{
+        return (size_t)cfg->world_width * (size_t)cfg->world_height;
+}
+
+/* tabuľka susedov: pre každé políčko 4 cieľové indexy s wrapom a prekážkami
+   (pohyb do prekážky ukazuje späť na to isté políčko);
+   indexy tabuľky sú v poradí cfg->layout, pri GRID_LAYOUT_ROWS zhodné s grid_idx_of */
+typedef struct {
+        int width;
+        int height;
+        int layout;             /* grid_layout_t */
+        uint32_t origin;        /* index [0,0] v tabuľke */
+        uint32_t *next;         /* next[4 * id + smer] */
+        uint32_t *to_row;       /* index tabuľky -> index po riadkoch (NULL = rovnaký) */
+        uint32_t *to_id;        /* index po riadkoch -> index tabuľky (NULL = rovnaký) */
+} grid_nbr_t;
+
+/* postaví tabuľku pre daný svet (obstacles je bitová mapa po riadkoch alebo NULL) */
+int grid_nbr_build(grid_nbr_t *t, const config *cfg, const uint64_t *obstacles);
+
+/* uvoľní tabuľku */
+void grid_nbr_free(grid_nbr_t *t);
+
+/* index tabuľky -> index po riadkoch */
+static inline uint32_t grid_nbr_row(const grid_nbr_t *t, uint32_t id)
+{
+        return t->to_row ? t->to_row[id] : id;
+}
+
+/* index po riadkoch -> index tabuľky */
+static inline uint32_t grid_nbr_id(const grid_nbr_t *t, uint32_t row)
+{
+        return t->to_id ? t->to_id[row] : row;
+}
+
+/* preusporiada pole s prvkami veľkosti elem z poradia po riadkoch do poradia tabuľky
+   (na mieste); 0 ok, -1 pri chybe pamäte */
+int grid_nbr_permute(const grid_nbr_t *t, void *a, size_t elem);
+
+/* opačný smer: z poradia tabuľky späť po riadkoch */
+int grid_nbr_unpermute(const grid_nbr_t *t, void *a, size_t elem);
+
+/* bitová mapa prekážok v poradí tabuľky (malloc); NULL pri obstacles == NULL alebo chybe pamäte */
+uint64_t *grid_nbr_bitmap(const grid_nbr_t *t, const uint64_t *obstacles);
+
+/* vzdialenosť nedosiahnuteľného políčka (a prekážky) */
+#define GRID_UNREACHABLE UINT32_MAX
+
+/* BFS z [0,0] cez wrapnutý svet okolo prekážok: dist[i] = najmenší počet krokov
+   z políčka i do [0,0]; vráti počet dosiahnutých políčok alebo -1 pri chybe pamäte */
+long grid_bfs_dist(const config *cfg, const uint64_t *obstacles, uint32_t *dist);
+
+/* voľné okolie: clear[i] = wrapnutá Manhattanova vzdialenosť z i k najbližšej
+   prekážke alebo k [0,0] (nasýtená na 255); 0 ok, -1 pri chybe pamäte */
+int grid_clearance(const config *cfg, const uint64_t *obstacles, uint8_t *clear);
+
+/* wrap súradníc na okraje sveta */
+static inline void grid_wrap_xy(const config *cfg, int *x, int *y)
+{
+        int min_x = -(cfg->world_width / 2);
+        int max_x = +(cfg->world_width / 2);
+        int min_y = -(cfg->world_height / 2);
+        int max_y = +(cfg->world_height / 2);
+
+        if (*x < min_x) *x = max_x;
+        if (*x > max_x) *x = min_x;
+        if (*y < min_y) *y = max_y;
+        if (*y > max_y) *y = min_y;
+}
+
+/* prepočet (x,y) na index do 1D poľa (riadky zhora, y je otočené) */
+static inline int grid_idx_of(const config *cfg, int x, int y)
+{
+        int ox = cfg->world_width / 2;
+        int oy = cfg->world_height / 2;
+        int ix = x + ox;
+        int iy = (oy - y);
+        return iy * cfg->world_width + ix;
+}
+
+/* spätný prepočet indexu na (x,y) */
+static inline void grid_xy_of(const config *cfg, int id, int *x, int *y)
+{
+        int w = cfg->world_width;
+        *x = id % w - w / 2;
+        *y = cfg->world_height / 2 - id / w;
+}
+
+/* smer kroku podľa náhodného čísla r z <0,1) */
+static inline int grid_dir_of(const probabilities_t *p, double r)
+{
+        double a = p->p_up;
+        double b = a + p->p_down;
+        double c = b + p->p_left;
+
+        if (r < a)
+                return GRID_UP;
+        if (r < b)
+                return GRID_DOWN;
+        if (r < c)
+                return GRID_LEFT;
+        return GRID_RIGHT;
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef JUMP_H
+#define JUMP_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "rng.h"
+
+/* makro-kroky: posun po m krokoch sa vyžrebuje naraz z alias tabuľky */
+#define JUMP_LEVELS 4
+
+/* jedna dĺžka skoku (m = 4, 8, 16, 32) */
+typedef struct {
+        uint32_t m;
+        uint32_t n;             /* počet možných posunov s nenulovou pravdepodobnosťou */
+        double *prob;           /* prah alias metódy pre každý stĺpec */
+        uint32_t *alias;        /* náhradný výsledok stĺpca */
+        int32_t *drow;          /* posun v riadkoch (hore = -1) */
+        int32_t *dcol;          /* posun v stĺpcoch (vpravo = +1) */
+} jump_level_t;
+
+typedef struct {
+        jump_level_t lv[JUMP_LEVELS];   /* od najkratšieho po najdlhší */
+} jump_table_t;
+
+/* rozdelenie posunu po m krokoch pre dané pravdepodobnosti */
+int jump_build(jump_table_t *t, const probabilities_t *p);
+
+/* uvoľní tabuľky */
+void jump_free(jump_table_t *t);
+
+/* najdlhší skok, ktorý sa zmestí do voľného okolia a do zvyšných krokov (-1 = žiadny) */
+static inline int jump_level_for(const jump_table_t *t, uint32_t clearance, uint32_t steps_left)
+{
+        for (int l = JUMP_LEVELS - 1; l >= 0; l--)
+                if (t->lv[l].m < clearance && t->lv[l].m <= steps_left)
+                        return l;
+        return -1;
+}
+
+/* vyžrebuje index posunu jedným číslom z <0,1) */
+static inline uint32_t jump_sample(const jump_level_t *lv, rng_t *rng)
+{
+        double u = rng_next01(rng) * (double)lv->n;
+        uint32_t k = (uint32_t)u;
+        if (k >= lv->n)
+                k = lv->n - 1;
+        return (u - (double)k < lv->prob[k]) ? k : lv->alias[k];
+}
+
+#endif
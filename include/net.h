@@ -1,11 +1,31 @@
 #pragma once
 
+#include <stddef.h>
+
 /* vytvorí UNIX socket a začne počúvať */
 int net_listen_unix(const char *path);
 
-/* prijme pripojenie na socket */
+/* prijme pripojenie na socket, vráti neblokujúci socket s FD_CLOEXEC
+   (-1 = nikto nečaká alebo chyba) */
 int net_accept(int listen_fd);
 
 /* pripojí sa k UNIX socketu */
 int net_connect_unix(const char *path);
 
+/* TCP socket s TCP_NODELAY na host:port (prázdny host = všetky rozhrania) */
+int net_listen_tcp(const char *host, const char *port);
+
+/* pripojí sa na host:port cez TCP (s TCP_NODELAY) */
+int net_connect_tcp(const char *host, const char *port);
+
+/* spoločná adresa pre server, klienta aj workery:
+   "tcp:host:port" (host môže byť [IPv6]), "unix:cesta" alebo len cesta k UNIX socketu;
+   -1 pri chybe alebo zlej adrese */
+int net_listen(const char *addr);
+int net_connect(const char *addr);
+
+/* skutočná adresa počúvajúceho TCP socketu (napr. po porte 0) v tvare "tcp:host:port" */
+int net_local_addr(int fd, char *out, size_t n);
+
+/* 1 ak je socket UNIX (klient na tom istom stroji) */
+int net_is_local(int fd);
@@ -0,0 +1,19 @@
+#ifndef NUMFMT_H
+#define NUMFMT_H
+
+#include <stddef.h>
+
+/* najdlhší zápis z numfmt_double aj s '\0' */
+#define NUMFMT_DOUBLE_MAX 32
+
+/* najkratší zápis double, z ktorého sa načíta presne tá istá hodnota (Ryu),
+   v tvare ako printf("%.17g"): bez koncových núl, exponent pre < 1e-4 a >= 1e17;
+   nezávisí od locale, vráti dĺžku bez '\0' */
+size_t numfmt_double(char *out, double v);
+
+/* prečíta double z [p, end) bez úvodných medzier (ako strtod v locale "C");
+   bežné čísla rýchlo (Clinger, Eisel-Lemire), zvyšok cez strtod;
+   vráti ukazovateľ za číslom, NULL ak tam číslo nie je */
+const char *numfmt_parse_double(const char *p, const char *end, double *out);
+
+#endif
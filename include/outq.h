@@ -0,0 +1,111 @@
+#ifndef OUTQ_H
+#define OUTQ_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "protocol.h"
+#include "persist.h"
+
+/* čo spraviť s klientom, ktorý nestíha čítať (front nad limitom) */
+typedef enum {
+        OUTQ_LAG_COALESCE = 0,  /* čakajúce kroky/delty nahradí najnovším stavom */
+        OUTQ_LAG_DROP,          /* nové kroky a delty zahadzuje, kým front neklesne */
+        OUTQ_LAG_DISCONNECT     /* odpojí ho */
+} outq_lag_t;
+
+/* trieda správy pre politiku zaostávajúcich klientov */
+typedef enum {
+        OUTQ_BULK = 0,          /* prekážky, summary, histogram: doručia sa vždy */
+        OUTQ_STEP,              /* krok interaktívneho režimu */
+        OUTQ_DELTA              /* priebežné summary (zmeny oproti predošlému) */
+} outq_class_t;
+
+/* komu rozoslať namiesto fd jedného klienta */
+#define OUTQ_ALL    (-1)        /* všetkým */
+#define OUTQ_REMOTE (-2)        /* klientom cez TCP */
+#define OUTQ_LOCAL  (-3)        /* klientom cez UNIX socket (môžu dostať fd) */
+
+typedef struct outq_item outq_item_t;
+
+/* správa zakódovaná raz (hlavičky aj dáta), nemenná a zdieľaná frontami
+   všetkých klientov; žije, kým ju drží niektorý front alebo volajúci */
+typedef struct outq_buf outq_buf_t;
+
+/* jeden klient: neblokujúci socket, front neodoslaných prenosov a rozčítaná správa */
+typedef struct outq_client outq_client_t;
+
+/* čo robí server s klientmi; volá sa z vlákna reaktora bez zámku frontov */
+typedef struct {
+        void (*on_accept)(void *user, int fd);  /* nový klient, už je v tabuľke */
+        /* celá správa od klienta (-1 = odpojiť ho) */
+        int (*on_message)(void *user, int fd, const msg_header_t *hdr, const void *payload);
+        void *user;
+} outq_handler_t;
+
+/* klienti a ich fronty; jedno vlákno reaktora (epoll) prijíma pripojenia,
+   číta správy a posiela z frontov, ostatné vlákna len pridávajú do frontov
+   a nikdy nečakajú na socket */
+typedef struct {
+        outq_client_t **clients;        /* hustá tabuľka, odstránenie výmenou s posledným */
+        size_t count;
+        size_t cap;
+        outq_client_t **by_fd;          /* klient podľa čísla fd */
+        size_t by_fd_cap;
+        outq_client_t *ready;           /* klienti s novými dátami alebo na odstránenie */
+        pthread_mutex_t mtx;
+
+        int epfd;
+        int wake_fd;                    /* eventfd na zobudenie reaktora */
+        int listen_fds[2];
+        int listen_count;
+        pthread_t tid;
+
+        outq_handler_t handler;
+        outq_lag_t policy;
+        uint64_t limit;                 /* bajty vo fronte, nad ktorými klient zaostáva */
+} outq_t;
+
+/* celý priebežný stav ako MSG_SUMMARY_DELTA pre klientov, ktorí delty vynechali;
+   volá sa najviac raz na jednu deltu, buffer sa uvoľní cez free (NULL pri chybe pamäte) */
+typedef void *(*outq_full_fn)(void *user, uint64_t *len);
+
+/* pripraví fronty (0 ok, -1 chyba) */
+int outq_init(outq_t *q, const outq_handler_t *handler, outq_lag_t policy, uint64_t limit);
+
+/* pridá počúvajúci socket (najviac dva), nové pripojenia prijíma reaktor */
+int outq_listen(outq_t *q, int fd);
+
+/* spustí vlákno reaktora (0 ok, -1 chyba) */
+int outq_start(outq_t *q);
+
+/* zakóduje správu (chunked = po kúskoch s msg_chunk_t, inak jedna správa);
+   ak data ležia v namapovanom súbore map, drží len hlavičky a dáta kúskov
+   idú cez sendfile zo súboru; NULL pri chybe pamäte */
+outq_buf_t *outq_frame(msg_type_t type, int chunked, const void *data, uint64_t total,
+                       const sim_mapping_t *map);
+
+/* malá správa, s ktorej prvým bajtom ide aj kópia fd (SCM_RIGHTS);
+   posiela sa len klientom cez UNIX socket, NULL pri chybe */
+outq_buf_t *outq_frame_fd(msg_type_t type, const void *payload, uint32_t size, int fd);
+
+/* pustí referenciu volajúceho (fronty si držia vlastné) */
+void outq_release(outq_buf_t *b);
+
+/* pridá správu do frontu jedného klienta (fd >= 0) alebo skupiny (OUTQ_ALL, ...);
+   pri rozosielaní sa na zaostávajúcich uplatní politika podľa triedy */
+void outq_send(outq_t *q, int fd, outq_buf_t *b, outq_class_t cls);
+
+/* jedna správa bez kúskov jednému klientovi (fd >= 0) alebo skupine (OUTQ_ALL, ...) */
+void outq_message(outq_t *q, int fd, msg_type_t type, outq_class_t cls, const void *payload, uint32_t size);
+
+/* veľký prenos po kúskoch (msg_chunk_t), doručí sa vždy; ak data ležia
+   v namapovanom súbore map, kúsky idú cez sendfile zo súboru */
+void outq_chunked(outq_t *q, int fd, msg_type_t type, const void *data, uint64_t total,
+                  const sim_mapping_t *map);
+
+/* MSG_SUMMARY_DELTA: zaostávajúcim klientom podľa politiky namiesto nej
+   celý stav z full (jednému klientovi fd >= 0 sa pošle vždy) */
+void outq_delta(outq_t *q, int fd, const void *data, uint64_t len, outq_full_fn full, void *user);
+
+#endif
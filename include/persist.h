@@ -1,26 +1,86 @@
 #ifndef PERSIST_H
 #define PERSIST_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include "config.h"
 #include "protocol.h"
+#include "fpt.h"
+#include "engine.h"
 
-/* uloží simuláciu do súboru */
+/* rozbehnutý výpočet summary: celý config, prekážky a stav enginu (všetko po riadkoch) */
+typedef struct {
+    config cfg;
+    uint64_t *obstacles;    /* NULL pri prázdnom svete */
+    engine_state_t state;
+    fpt_hist_t hist;        /* hist.cells == 0 = bez histogramu */
+} checkpoint_t;
+
+/* namapovaný binárny súbor s výsledkami (base NULL = nič nenamapované);
+   offset poľa v súbore je jeho vzdialenosť od base */
+typedef struct {
+    void *base;
+    size_t len;
+    int fd;             /* otvorený súbor, z ktorého sa dá posielať cez sendfile */
+} sim_mapping_t;
+
+/* uloží simuláciu do súboru (reps_used môže byť NULL = všade cfg->replications,
+   hits a steps_sum NULL = bez surových počtov, hist NULL = bez histogramu časov príchodu);
+   so surovými počtami sa súbor dá spojiť s inými behmi;
+   cesta s príponou .txt = textový formát, inak binárny (verzovaná hlavička a surové polia) */
 int save_simulation(
     const char *path,
     const config *cfg,
-    const uint8_t *obstacles,
-    const msg_sum_cell_t *summary_cells
+    const uint64_t *obstacles,
+    const msg_sum_cell_t *summary_cells,
+    const uint32_t *reps_used,
+    const uint64_t *hits,
+    const uint64_t *steps_sum,
+    const fpt_hist_t *hist
 );
 
-/* načíta simuláciu zo súboru */
+/* načíta simuláciu zo súboru (*obstacles_out je NULL pri prázdnom svete,
+   *reps_used_out je NULL, ak ich súbor nemá, *hits_out a *steps_sum_out sú NULL
+   bez surových počtov, hist_out->cells == 0, ak súbor nemá histogram);
+   binárny súbor sa s map_out namapuje a polia ukazujú priamo do neho (neuvoľňujú sa,
+   hist_out->reps je ten istý ako *reps_used_out, koniec cez unmap_simulation),
+   inak (aj pri textovom súbore) sú polia alokované */
 int load_simulation(
     const char *path,
     config *cfg_out,
-    uint8_t **obstacles_out,
-    msg_sum_cell_t **summary_out
+    uint64_t **obstacles_out,
+    msg_sum_cell_t **summary_out,
+    uint32_t **reps_used_out,
+    uint64_t **hits_out,
+    uint64_t **steps_sum_out,
+    fpt_hist_t *hist_out,
+    sim_mapping_t *map_out
 );
 
-#endif
+/* uvoľní mapovanie z load_simulation (polia z neho prestanú platiť) */
+void unmap_simulation(sim_mapping_t *map);
 
+/* rozmery sveta zo súboru s výsledkami alebo checkpointu bez načítania dát */
+int simulation_size(const char *path, int *w_out, int *h_out);
+
+/* summary zo surových počtov (po riadkoch), rovnako ako po výpočte */
+void summary_from_counters(
+    const config *cfg,
+    const uint64_t *hits,
+    const uint64_t *steps_sum,
+    const uint32_t *reps_used,
+    msg_sum_cell_t *out
+);
+
+/* zapíše checkpoint atomicky (dočasný súbor, fsync, rename), takže pri páde
+   ostane na path vždy celý predchádzajúci alebo nový checkpoint */
+int save_checkpoint(const char *path, const checkpoint_t *ck);
+
+/* načíta checkpoint (polia alokuje, uvoľní ich checkpoint_free) */
+int load_checkpoint(const char *path, checkpoint_t *ck);
+
+/* uvoľní polia checkpointu */
+void checkpoint_free(checkpoint_t *ck);
+
+#endif
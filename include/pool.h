@@ -0,0 +1,23 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdint.h>
+
+/* práca pre jednu úlohu; worker = index vlákna v poole */
+typedef void (*pool_task_fn)(void *ctx, int worker, uint64_t task);
+
+typedef struct pool pool_t;
+
+/* vytvorí pool vlákien (threads <= 0 -> podľa počtu CPU) */
+pool_t *pool_create(int threads);
+
+/* počet vlákien v poole */
+int pool_threads(const pool_t *p);
+
+/* rozdelí úlohy [0, ntasks) medzi vlákna (work stealing) a počká na ich koniec */
+void pool_run(pool_t *p, uint64_t ntasks, pool_task_fn fn, void *ctx);
+
+/* zastaví vlákna a uvoľní pamäť */
+void pool_destroy(pool_t *p);
+
+#endif
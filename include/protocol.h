@@ -8,9 +8,16 @@ typedef enum {
     MSG_CONFIG            = 1,
     MSG_INTERACTIVE_STEP  = 2,
     MSG_SUMMARY_DATA      = 3,
-    MSG_OBSTACLES         = 4
+    MSG_OBSTACLES         = 4,    /* bitová mapa (bitmap.h), total 0 = prázdny svet */
+    MSG_FPT_HIST          = 5,    /* histogram časov prvého príchodu (fpt.h) */
+    MSG_SUMMARY_DELTA     = 6,    /* priebežné summary: len políčka zmenené od minulého */
+    MSG_SHM_READY         = 7     /* výsledky sú v zdieľanej pamäti (len cez UNIX socket) */
 } msg_type_t;
 
+/* summary, prekážky, histogram a priebežné summary idú po kúskoch: každá správa má za hlavičkou
+   msg_chunk_t a najviac MSG_CHUNK_MAX bajtov dát (size = sizeof(msg_chunk_t) + dáta) */
+#define MSG_CHUNK_MAX (1u << 20)
+
 /* hlavička správy */
 typedef struct {
     msg_type_t type;
@@ -32,5 +39,68 @@ typedef struct {
     double probability;
 } msg_sum_cell_t;
 
-#endif
+/* poloha kúska vo veľkom prenose (64-bitové veľkosti) */
+typedef struct {
+    uint64_t total;     /* veľkosť celého prenosu v bajtoch (0 = prázdny, napr. svet bez prekážok) */
+    uint64_t offset;    /* kde v prenose začínajú dáta tohto kúska */
+    uint32_t seq;       /* poradové číslo kúska od 0 */
+    uint32_t last;      /* 1 = posledný kúsok prenosu */
+} msg_chunk_t;
+
+/* hlavička MSG_FPT_HIST, za ňou idú polia steps (uint64), hits a reps (uint32) */
+typedef struct {
+    uint32_t width;
+    uint32_t buckets;
+    uint32_t cells;
+    uint32_t max_steps;
+    uint32_t origin;
+    uint32_t reserved;
+} msg_fpt_hdr_t;
+
+/* hlavička MSG_SUMMARY_DELTA, za ňou count x msg_delta_cell_t */
+typedef struct {
+    uint32_t reps_done;     /* dokončené replikácie */
+    uint32_t replications;  /* celkom plánované */
+    uint64_t cells_active;  /* políčka, ktoré ešte bežia */
+    uint32_t count;
+    uint32_t reserved;
+} msg_delta_hdr_t;
+
+/* nová hodnota jedného políčka (index po riadkoch ako v MSG_SUMMARY_DATA) */
+typedef struct {
+    uint32_t index;
+    uint32_t reserved;
+    msg_sum_cell_t cell;
+} msg_delta_cell_t;
+
+/* MSG_SHM_READY: klientom na tom istom stroji server namiesto prekážok a summary
+   pošle len túto správu a s ňou (SCM_RIGHTS) fd segmentu zdieľanej pamäte */
+typedef struct {
+    uint64_t size;          /* veľkosť segmentu */
+    uint64_t generation;    /* verzia, ktorú má klient čítať */
+    uint32_t flags;         /* MSG_SHM_HAS_* */
+    uint32_t reserved;
+} msg_shm_ready_t;
+
+#define MSG_SHM_MAGIC 0x4d4853534d495352ull   /* "RSIMSSHM" */
 
+#define MSG_SHM_HAS_OBSTACLES 1u
+#define MSG_SHM_HAS_SUMMARY   2u
+
+/* začiatok segmentu; seq je seqlock (nepárne = server práve zapisuje),
+   polia sa po zverejnení už neprepisujú, klient ich číta priamo z mapovania */
+typedef struct {
+    uint64_t magic;
+    uint64_t seq;
+    uint64_t generation;    /* zvyšuje sa s každým zverejnením */
+    uint32_t world_width;
+    uint32_t world_height;
+    uint64_t obstacles_off; /* bitová mapa (obstacles_len 0 = prázdny svet) */
+    uint64_t obstacles_len;
+    uint64_t summary_off;   /* msg_sum_cell_t po riadkoch */
+    uint64_t summary_len;
+    uint32_t flags;         /* MSG_SHM_HAS_* */
+    uint32_t reserved;
+} msg_shm_hdr_t;
+
+#endif
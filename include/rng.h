@@ -0,0 +1,60 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* generátor xoshiro256++ (stav 256 bitov, bez globálneho stavu) */
+typedef struct {
+        uint64_t s[4];
+} rng_t;
+
+/* splitmix64 - používa sa na rozptýlenie seedu do stavu */
+static inline uint64_t rng_splitmix64(uint64_t *x)
+{
+        uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+}
+
+static inline uint64_t rng_rotl(uint64_t x, int k)
+{
+        return (x << k) | (x >> (64 - k));
+}
+
+/* ďalšie 64-bitové číslo */
+static inline uint64_t rng_next(rng_t *r)
+{
+        uint64_t *s = r->s;
+        uint64_t result = rng_rotl(s[0] + s[3], 23) + s[0];
+        uint64_t t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rng_rotl(s[3], 45);
+
+        return result;
+}
+
+/* náhodné číslo v <0,1) - horných 52 bitov do mantisy čísla z <1,2) */
+static inline double rng_next01(rng_t *r)
+{
+        union {
+                uint64_t i;
+                double d;
+        } u;
+        u.i = (rng_next(r) >> 12) | 0x3FF0000000000000ULL;
+        return u.d - 1.0;
+}
+
+/* nezávislý prúd pre (seed, stream, substream);
+   stream 0 patrí serveru, replikácia r používa stream r+1 a substream = políčko */
+void rng_init(rng_t *r, uint64_t seed, uint64_t stream, uint64_t substream);
+
+/* nový seed z času a PID (keď ho klient nezadal) */
+uint64_t rng_random_seed(void);
+
+#endif
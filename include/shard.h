@@ -0,0 +1,16 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdint.h>
+
+#include "engine.h"
+
+/* to isté ako engine_run, ale replikácie počíta workers procesov (fork, UNIX sockety):
+   master im rozdáva rozsahy replikácií, sčíta vrátené počty a rozsah padnutého
+   workera pridelí znova; výsledok je rovnaký ako z engine_run, lebo prúdy chodcov
+   závisia len od seedu, replikácie a políčka.
+   on_batch a on_snapshot sa volajú po každom dokončenom rozsahu;
+   adaptívny režim, checkpoint ani resume nepodporuje */
+int shard_run(const engine_job_t *job, int workers, uint64_t *hits, uint64_t *steps_sum, uint32_t *reps_used);
+
+#endif
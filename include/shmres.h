@@ -0,0 +1,34 @@
+#ifndef SHMRES_H
+#define SHMRES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+/* segment zdieľanej pamäte s výsledkami: msg_shm_hdr_t, bitová mapa prekážok, summary */
+typedef struct {
+        int fd;                 /* -1 = nič */
+        uint8_t *base;
+        size_t len;
+} shmres_t;
+
+/* server: nový segment pre svet w x h; meno sa hneď odlinkuje, klienti
+   dostanú fd cez UNIX socket, takže po páde servera nič neostane (0 ok, -1 chyba) */
+int shmres_create(shmres_t *r, uint32_t w, uint32_t h);
+
+/* server: zapíše prekážky (NULL = prázdny svet) a zverejní novú generáciu, vráti ju */
+uint64_t shmres_put_obstacles(shmres_t *r, const uint64_t *obstacles);
+
+/* server: zapíše summary (po riadkoch) a zverejní novú generáciu, vráti ju */
+uint64_t shmres_put_summary(shmres_t *r, const msg_sum_cell_t *cells);
+
+/* klient: namapuje segment z fd len na čítanie (fd potom patrí segmentu) */
+int shmres_attach(shmres_t *r, int fd);
+
+/* konzistentná kópia hlavičky cez seqlock (-1 = segment nie je platný) */
+int shmres_header(const shmres_t *r, msg_shm_hdr_t *out);
+
+void shmres_close(shmres_t *r);
+
+#endif
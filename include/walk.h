@@ -0,0 +1,30 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "grid.h"
+#include "jump.h"
+
+/* prostredie, v ktorom chodci chodia */
+typedef struct {
+        const config *cfg;
+        const grid_nbr_t *nbr;      /* susedia s wrapom a prekážkami */
+        const uint32_t *dist;       /* vzdialenosti do [0,0]; chodec, ktorý už nestihne
+                                       dôjsť do K krokov, sa ukončí (NULL = nie) */
+        const jump_table_t *jump;   /* makro-kroky (NULL = krok po kroku) */
+        const uint8_t *clear;       /* voľné okolie políčok, povinné pri jump */
+        uint64_t seed;
+} walk_env_t;
+
+/* odsimuluje chodcov štartujúcich na políčkach cells[0..n) v replikácii rep (od 0);
+   cells, dist a clear sú v poradí tabuľky, prúd náhodných čísel chodca patrí jeho
+   indexu po riadkoch, takže výsledky nezávisia od layoutu;
+   hit_step[i] = krok, v ktorom chodec trafil [0,0], alebo 0 ak nedošiel do K krokov */
+void walk_batch(const walk_env_t *env, uint32_t rep, const int *cells, int n, uint32_t *hit_step);
+
+/* názov jadra, ktoré sa vybralo podľa CPU */
+const char *walk_kernel_name(void);
+
+#endif
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,10 +8,16 @@
 #include <sys/socket.h>
 #include <stdint.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/wait.h>
 
 #include "net.h"
 #include "protocol.h"
 #include "config.h"
+#include "fpt.h"
+#include "persist.h"
+#include "bitmap.h"
+#include "shmres.h"
 
 /* čo sa má zobrazovať v summary */
 typedef enum {
@@ -26,15 +34,26 @@ typedef struct {
 
         pthread_mutex_t mtx;
 
-        uint8_t *obstacles;
+        uint64_t *obstacles;        /* bitová mapa, NULL pri prázdnom svete */
         int obstacles_ready;
+        int obstacles_shared;       /* ukazuje do shm, neuvoľňuje sa */
 
         msg_sum_cell_t *summary;
         int summary_ready;
+        int summary_shared;         /* ukazuje do shm (len na čítanie), neuvoľňuje sa */
+        int live;                   /* 1 = summary je priebežné, výpočet ešte beží */
+        msg_delta_hdr_t live_hdr;   /* posledné priebežné summary */
+
+        fpt_hist_t hist;            /* časy príchodu zo servera (hist.cells == 0 = nie sú) */
+        uint32_t horizon;           /* K, pre ktoré sa zobrazuje summary (0 = pôvodné) */
 
         display_t display;
+
+        shmres_t shm;               /* výsledky zo servera na tom istom stroji (fd < 0 = nie sú) */
 } client_ctx_t;
 
+static int ask_int(const char *prompt);
+
 /* prečíta presne len bajtov zo socketu - navrhnuté AI*/
 static int read_full(int fd, void *buf, size_t len)
 {
@@ -100,7 +119,7 @@ static void draw_world(client_ctx_t *ctx, int wx, int wy)
                                 continue;
                         }
 
-                        if (ctx->obstacles_ready && ctx->obstacles && ctx->obstacles[y * w + x])
+                        if (ctx->obstacles_ready && ctx->obstacles && bitmap_get(ctx->obstacles, (size_t)(y * w + x)))
                                 putchar('#'); /* prekážka */
                         else
                                 putchar('.'); /* voľné */
@@ -134,8 +153,17 @@ static void display_summary(client_ctx_t *ctx)
         int h = ctx->world_height;
 
         clear_screen();
-        printf("=== SUMMARY (%s) ===\n\n",
-                ctx->display == DISPLAY_AVG ? "AVG STEPS" : "PROBABILITY");
+        if (ctx->live)
+                printf("=== SUMMARY (%s, live: %u / %u replications, %llu cells running) ===\n\n",
+                        ctx->display == DISPLAY_AVG ? "AVG STEPS" : "PROBABILITY",
+                        (unsigned)ctx->live_hdr.reps_done, (unsigned)ctx->live_hdr.replications,
+                        (unsigned long long)ctx->live_hdr.cells_active);
+        else if (ctx->horizon > 0)
+                printf("=== SUMMARY (%s, K = %u) ===\n\n",
+                        ctx->display == DISPLAY_AVG ? "AVG STEPS" : "PROBABILITY", (unsigned)ctx->horizon);
+        else
+                printf("=== SUMMARY (%s) ===\n\n",
+                        ctx->display == DISPLAY_AVG ? "AVG STEPS" : "PROBABILITY");
 
         if (!ctx->summary_ready || !ctx->summary || w <= 0 || h <= 0) {
                 printf("(summary not ready)\n\n");
@@ -148,7 +176,7 @@ static void display_summary(client_ctx_t *ctx)
                 for (int x = 0; x < w; x++) {
                         int id = y * w + x;
 
-                        if (ctx->obstacles_ready && ctx->obstacles && ctx->obstacles[id]) {
+                        if (ctx->obstacles_ready && ctx->obstacles && bitmap_get(ctx->obstacles, (size_t)id)) {
                                 printf("   ### ");
                                 continue;
                         }
@@ -162,36 +190,263 @@ static void display_summary(client_ctx_t *ctx)
                 printf("\n");
         }
 
-        printf("\n[a] avg   [p] prob   [q] quit\n");
+        if (ctx->hist.cells > 0)
+                printf("\n[a] avg   [p] prob   [k] horizon K (1..%u)   [q] quit\n", (unsigned)ctx->hist.max_steps);
+        else
+                printf("\n[a] avg   [p] prob   [q] quit\n");
         fflush(stdout);
 }
 
+/* rozpracovaný prenos po kúskoch (summary, prekážky, histogram) */
+typedef struct {
+        uint8_t *buf;
+        uint64_t total;
+        uint64_t got;
+        uint32_t next_seq;
+        int active;
+} chunk_rx_t;
+
+/* prečíta hlavičku správy; fd poslané s ňou (SCM_RIGHTS) vráti v *pass_fd, inak -1 */
+static int read_header(int fd, msg_header_t *hdr, int *pass_fd)
+{
+        uint8_t *bytes = (uint8_t *)hdr;
+        size_t got = 0;
+
+        *pass_fd = -1;
+        while (got < sizeof(*hdr)) {
+                struct iovec iov;
+                iov.iov_base = bytes + got;
+                iov.iov_len = sizeof(*hdr) - got;
+
+                union {
+                        struct cmsghdr align;
+                        char buf[CMSG_SPACE(sizeof(int))];
+                } ctl;
+                struct msghdr mh;
+                memset(&mh, 0, sizeof(mh));
+                mh.msg_iov = &iov;
+                mh.msg_iovlen = 1;
+                mh.msg_control = ctl.buf;
+                mh.msg_controllen = sizeof(ctl.buf);
+
+                ssize_t n = recvmsg(fd, &mh, MSG_CMSG_CLOEXEC);
+                if (n < 0 && errno == EINTR)
+                        continue;
+                if (n <= 0)
+                        break;
+
+                for (struct cmsghdr *cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+                        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS)
+                                continue;
+                        size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                        for (size_t i = 0; i < count; i++) {
+                                int x;
+                                memcpy(&x, CMSG_DATA(cm) + i * sizeof(int), sizeof(x));
+                                if (*pass_fd < 0)
+                                        *pass_fd = x;
+                                else
+                                        close(x);
+                        }
+                }
+                got += (size_t)n;
+        }
+
+        if (got == sizeof(*hdr))
+                return 0;
+        if (*pass_fd >= 0)
+                close(*pass_fd);
+        *pass_fd = -1;
+        return -1;
+}
+
+/* zahodí n bajtov zo socketu */
+static int skip_bytes(int fd, uint64_t n)
+{
+        uint8_t tmp[4096];
+
+        while (n > 0) {
+                size_t k = n > sizeof(tmp) ? sizeof(tmp) : (size_t)n;
+                if (read_full(fd, tmp, k) != 0)
+                        return -1;
+                n -= k;
+        }
+        return 0;
+}
+
+/* prečíta jeden kúsok rovno na jeho miesto vo výslednom poli;
+   expect = očakávaná veľkosť (0 = ľubovoľná, prázdny prenos je vždy povolený)
+   1 = prenos je kompletný (*out, *len, pole patrí volajúcemu), 0 = pokračuje, -1 = spojenie padlo */
+static int recv_chunk(int fd, const msg_header_t *hdr, chunk_rx_t *rx, uint64_t expect,
+                      uint8_t **out, uint64_t *len)
+{
+        msg_chunk_t ch;
+
+        if (hdr->size < sizeof(ch))
+                return skip_bytes(fd, hdr->size);
+        if (read_full(fd, &ch, sizeof(ch)) != 0)
+                return -1;
+
+        uint64_t n = hdr->size - sizeof(ch);
+
+        /* prvý kúsok: nové pole na celý prenos */
+        if (ch.seq == 0) {
+                free(rx->buf);
+                memset(rx, 0, sizeof(*rx));
+                if (ch.total > 0 && expect > 0 && ch.total != expect)
+                        return skip_bytes(fd, n);
+                if (ch.total > 0) {
+                        rx->buf = malloc((size_t)ch.total);
+                        if (!rx->buf)
+                                return skip_bytes(fd, n);
+                }
+                rx->total = ch.total;
+                rx->active = 1;
+        }
+
+        /* kúsky musia ísť po poradí a za sebou, inak prenos zahodíme */
+        if (!rx->active || ch.seq != rx->next_seq || ch.total != rx->total ||
+            ch.offset != rx->got || n > rx->total - rx->got) {
+                free(rx->buf);
+                memset(rx, 0, sizeof(*rx));
+                return skip_bytes(fd, n);
+        }
+
+        if (n > 0 && read_full(fd, rx->buf + rx->got, (size_t)n) != 0)
+                return -1;
+        rx->got += n;
+        rx->next_seq++;
+
+        if (!ch.last)
+                return 0;
+
+        if (rx->got != rx->total) {
+                free(rx->buf);
+                memset(rx, 0, sizeof(*rx));
+                return 0;
+        }
+
+        *out = rx->buf;
+        *len = rx->total;
+        memset(rx, 0, sizeof(*rx));
+        return 1;
+}
+
+/* MSG_SHM_READY: prekážky a summary sa čítajú priamo zo segmentu od servera
+   namiesto kópie cez socket (-1 = spojenie padlo) */
+static int recv_shm_ready(client_ctx_t *ctx, const msg_header_t *hdr, int fd)
+{
+        size_t cells = (size_t)ctx->world_width * (size_t)ctx->world_height;
+        msg_shm_ready_t m;
+
+        if (hdr->size != sizeof(m)) {
+                if (fd >= 0)
+                        close(fd);
+                return skip_bytes(ctx->sock_fd, hdr->size);
+        }
+        if (read_full(ctx->sock_fd, &m, sizeof(m)) != 0) {
+                if (fd >= 0)
+                        close(fd);
+                return -1;
+        }
+        if (fd < 0)
+                return 0;
+
+        shmres_t seg;
+        msg_shm_hdr_t sh;
+        if (shmres_attach(&seg, fd) != 0)
+                return 0;
+
+        /* segment musí mať oznámenú verziu a polia presne pre náš svet */
+        if (shmres_header(&seg, &sh) != 0 ||
+            sh.world_width != (uint32_t)ctx->world_width || sh.world_height != (uint32_t)ctx->world_height ||
+            sh.generation < m.generation || (sh.flags & m.flags) != m.flags ||
+            ((m.flags & MSG_SHM_HAS_OBSTACLES) && sh.obstacles_len != 0 &&
+             sh.obstacles_len != bitmap_bytes(cells)) ||
+            ((m.flags & MSG_SHM_HAS_SUMMARY) && sh.summary_len != cells * sizeof(msg_sum_cell_t))) {
+                shmres_close(&seg);
+                return 0;
+        }
+
+        pthread_mutex_lock(&ctx->mtx);
+
+        /* polia zo starého segmentu zmiznú s ním */
+        if (ctx->obstacles_shared) {
+                ctx->obstacles = NULL;
+                ctx->obstacles_ready = 0;
+                ctx->obstacles_shared = 0;
+        }
+        if (ctx->summary_shared) {
+                ctx->summary = NULL;
+                ctx->summary_ready = 0;
+                ctx->summary_shared = 0;
+        }
+        shmres_close(&ctx->shm);
+        ctx->shm = seg;
+
+        if (m.flags & MSG_SHM_HAS_OBSTACLES) {
+                free(ctx->obstacles);
+                ctx->obstacles = sh.obstacles_len ? (uint64_t *)(void *)(seg.base + sh.obstacles_off) : NULL;
+                ctx->obstacles_ready = 1;
+                ctx->obstacles_shared = 1;
+        }
+        if (m.flags & MSG_SHM_HAS_SUMMARY) {
+                free(ctx->summary);
+                ctx->summary = (msg_sum_cell_t *)(void *)(seg.base + sh.summary_off);
+                ctx->summary_ready = 1;
+                ctx->summary_shared = 1;
+                ctx->live = 0;
+                ctx->horizon = 0;
+                ctx->display = DISPLAY_AVG;
+                display_summary(ctx);
+        }
+        pthread_mutex_unlock(&ctx->mtx);
+        return 0;
+}
+
 /* vlákno: prijíma správy zo servera a aktualizuje stav */
 static void *recv_thread(void *arg)
 {
         client_ctx_t *ctx = (client_ctx_t *)arg;
 
+        size_t cells = (size_t)ctx->world_width * (size_t)ctx->world_height;
+        chunk_rx_t rx_obst, rx_sum, rx_hist, rx_delta;
+        memset(&rx_obst, 0, sizeof(rx_obst));
+        memset(&rx_sum, 0, sizeof(rx_sum));
+        memset(&rx_hist, 0, sizeof(rx_hist));
+        memset(&rx_delta, 0, sizeof(rx_delta));
+
         while (1) {
                 msg_header_t hdr;
+                int pass_fd;
 
-                if (read_full(ctx->sock_fd, &hdr, sizeof(hdr)) != 0)
+                if (read_header(ctx->sock_fd, &hdr, &pass_fd) != 0)
                         break;
 
-                /* prekážky */
-                if (hdr.type == MSG_OBSTACLES) {
-                        uint8_t *buf = malloc(hdr.size);
-                        if (!buf)
+                /* fd prichádza len s MSG_SHM_READY */
+                if (hdr.type == MSG_SHM_READY) {
+                        if (recv_shm_ready(ctx, &hdr, pass_fd) != 0)
                                 break;
+                        continue;
+                }
+                if (pass_fd >= 0)
+                        close(pass_fd);
 
-                        if (read_full(ctx->sock_fd, buf, hdr.size) != 0) {
-                                free(buf);
+                /* prekážky (bitová mapa, prázdny prenos = prázdny svet) */
+                if (hdr.type == MSG_OBSTACLES) {
+                        uint8_t *buf = NULL;
+                        uint64_t len = 0;
+                        int r = recv_chunk(ctx->sock_fd, &hdr, &rx_obst, bitmap_bytes(cells), &buf, &len);
+                        if (r < 0)
                                 break;
-                        }
+                        if (r == 0)
+                                continue;
 
                         pthread_mutex_lock(&ctx->mtx);
-                        free(ctx->obstacles);
-                        ctx->obstacles = buf;
+                        if (!ctx->obstacles_shared)
+                                free(ctx->obstacles);
+                        ctx->obstacles = (uint64_t *)(void *)buf;
                         ctx->obstacles_ready = 1;
+                        ctx->obstacles_shared = 0;
                         pthread_mutex_unlock(&ctx->mtx);
 
                 /* interaktívny krok */
@@ -200,14 +455,8 @@ static void *recv_thread(void *arg)
 
                         /* ak veľkosť nesedí, preskočíme payload */
                         if (hdr.size != sizeof(msg)) {
-                                uint8_t *skip = malloc(hdr.size);
-                                if (!skip)
+                                if (skip_bytes(ctx->sock_fd, hdr.size) != 0)
                                         break;
-                                if (read_full(ctx->sock_fd, skip, hdr.size) != 0) {
-                                        free(skip);
-                                        break;
-                                }
-                                free(skip);
                                 continue;
                         }
 
@@ -218,43 +467,111 @@ static void *recv_thread(void *arg)
 
                 /* summary */
                 } else if (hdr.type == MSG_SUMMARY_DATA) {
-                        msg_sum_cell_t *buf = malloc(hdr.size);
-                        if (!buf)
+                        uint8_t *buf = NULL;
+                        uint64_t len = 0;
+                        int r = recv_chunk(ctx->sock_fd, &hdr, &rx_sum, cells * sizeof(msg_sum_cell_t), &buf, &len);
+                        if (r < 0)
                                 break;
-
-                        if (read_full(ctx->sock_fd, buf, hdr.size) != 0) {
-                                free(buf);
-                                break;
-                        }
+                        if (r == 0 || !buf)
+                                continue;
 
                         pthread_mutex_lock(&ctx->mtx);
-                        free(ctx->summary);
-                        ctx->summary = buf;
+                        if (!ctx->summary_shared)
+                                free(ctx->summary);
+                        ctx->summary = (msg_sum_cell_t *)(void *)buf;
                         ctx->summary_ready = 1;
+                        ctx->summary_shared = 0;
+                        ctx->live = 0;
+                        ctx->horizon = 0;
                         ctx->display = DISPLAY_AVG;
                         display_summary(ctx);
                         pthread_mutex_unlock(&ctx->mtx);
 
-                /* neznámy typ -> len preskočíme dáta */
-                } else {
-                        if (hdr.size > 0) {
-                                uint8_t *skip = malloc(hdr.size);
-                                if (!skip)
-                                        break;
-                                if (read_full(ctx->sock_fd, skip, hdr.size) != 0) {
-                                        free(skip);
-                                        break;
+                /* priebežné summary: zmenené políčka sa prepíšu na mieste */
+                } else if (hdr.type == MSG_SUMMARY_DELTA) {
+                        uint8_t *buf = NULL;
+                        uint64_t len = 0;
+                        int r = recv_chunk(ctx->sock_fd, &hdr, &rx_delta, 0, &buf, &len);
+                        if (r < 0)
+                                break;
+                        if (r == 0 || !buf)
+                                continue;
+
+                        msg_delta_hdr_t dh;
+                        if (len < sizeof(dh)) {
+                                free(buf);
+                                continue;
+                        }
+                        memcpy(&dh, buf, sizeof(dh));
+                        if (len != sizeof(dh) + (uint64_t)dh.count * sizeof(msg_delta_cell_t)) {
+                                free(buf);
+                                continue;
+                        }
+
+                        pthread_mutex_lock(&ctx->mtx);
+                        /* finálne summary už prišlo, staršie priebežné ho neprepíše */
+                        if ((ctx->summary_ready && !ctx->live) || ctx->summary_shared) {
+                                pthread_mutex_unlock(&ctx->mtx);
+                                free(buf);
+                                continue;
+                        }
+                        if (!ctx->summary)
+                                ctx->summary = calloc(cells, sizeof(msg_sum_cell_t));
+                        if (ctx->summary) {
+                                const uint8_t *p = buf + sizeof(dh);
+                                for (uint32_t i = 0; i < dh.count; i++, p += sizeof(msg_delta_cell_t)) {
+                                        msg_delta_cell_t c;
+                                        memcpy(&c, p, sizeof(c));
+                                        if (c.index < cells)
+                                                ctx->summary[c.index] = c.cell;
                                 }
-                                free(skip);
+                                ctx->summary_ready = 1;
+                                ctx->live = 1;
+                                ctx->live_hdr = dh;
+                                display_summary(ctx);
                         }
+                        pthread_mutex_unlock(&ctx->mtx);
+                        free(buf);
+
+                /* histogram časov príchodu (prichádza po summary) */
+                } else if (hdr.type == MSG_FPT_HIST) {
+                        uint8_t *buf = NULL;
+                        uint64_t len = 0;
+                        int r = recv_chunk(ctx->sock_fd, &hdr, &rx_hist, 0, &buf, &len);
+                        if (r < 0)
+                                break;
+                        if (r == 0 || !buf)
+                                continue;
+
+                        fpt_hist_t hist;
+                        int ok = fpt_decode(&hist, buf, (size_t)len) == 0;
+                        free(buf);
+                        if (!ok)
+                                continue;
+
+                        pthread_mutex_lock(&ctx->mtx);
+                        fpt_free(&ctx->hist);
+                        ctx->hist = hist;
+                        if (ctx->summary_ready)
+                                display_summary(ctx);
+                        pthread_mutex_unlock(&ctx->mtx);
+
+                /* neznámy typ -> len preskočíme dáta */
+                } else {
+                        if (skip_bytes(ctx->sock_fd, hdr.size) != 0)
+                                break;
                 }
         }
 
+        free(rx_obst.buf);
+        free(rx_sum.buf);
+        free(rx_hist.buf);
+        free(rx_delta.buf);
         return NULL;
 }
 
 /* pripojí sa na server a spustí UI - AI pomáhalo opraviť errory */
-static void run_client(const config *cfg, const char *sock_path, int send_cfg)
+static void run_client(const config *cfg, const char *addr, int send_cfg)
 {
         client_ctx_t ctx;
 
@@ -266,10 +583,11 @@ static void run_client(const config *cfg, const char *sock_path, int send_cfg)
                 ctx.world_height = cfg->world_height;
         }
         ctx.display = DISPLAY_AVG;
+        ctx.shm.fd = -1;
 
-        printf("[CLIENT] connecting to %s...\n", sock_path);
+        printf("[CLIENT] connecting to %s...\n", addr);
 
-        ctx.sock_fd = net_connect_unix(sock_path);
+        ctx.sock_fd = net_connect(addr);
         if (ctx.sock_fd < 0) {
                 printf("[CLIENT] connection failed\n");
                 return;
@@ -313,6 +631,38 @@ static void run_client(const config *cfg, const char *sock_path, int send_cfg)
                                 ctx.display = DISPLAY_PROB;
                                 display_summary(&ctx);
                                 pthread_mutex_unlock(&ctx.mtx);
+                        } else if (ch == 'k') {
+                                /* iný horizont sa spočíta z histogramu bez nového behu */
+                                while (ch != '\n' && ch != EOF)
+                                        ch = getchar();
+
+                                pthread_mutex_lock(&ctx.mtx);
+                                int have = ctx.hist.cells == (size_t)ctx.world_width * (size_t)ctx.world_height;
+                                pthread_mutex_unlock(&ctx.mtx);
+                                if (!have)
+                                        continue;
+
+                                int k = ask_int("Horizon K: ");
+
+                                pthread_mutex_lock(&ctx.mtx);
+
+                                /* summary zo zdieľanej pamäte je len na čítanie, prepočíta sa do vlastnej kópie */
+                                if (k > 0 && ctx.summary_shared) {
+                                        size_t bytes = (size_t)ctx.world_width * (size_t)ctx.world_height *
+                                                       sizeof(msg_sum_cell_t);
+                                        msg_sum_cell_t *own = malloc(bytes);
+                                        if (own) {
+                                                memcpy(own, ctx.summary, bytes);
+                                                ctx.summary = own;
+                                                ctx.summary_shared = 0;
+                                        }
+                                }
+                                if (k > 0 && !ctx.summary_shared) {
+                                        ctx.horizon = fpt_horizon(&ctx.hist, (uint32_t)k);
+                                        fpt_summary(&ctx.hist, ctx.horizon, ctx.summary);
+                                }
+                                display_summary(&ctx);
+                                pthread_mutex_unlock(&ctx.mtx);
                         }
                 }
 
@@ -326,8 +676,12 @@ static void run_client(const config *cfg, const char *sock_path, int send_cfg)
         pthread_join(tid, NULL);
         pthread_mutex_destroy(&ctx.mtx);
 
-        free(ctx.obstacles);
-        free(ctx.summary);
+        if (!ctx.obstacles_shared)
+                free(ctx.obstacles);
+        if (!ctx.summary_shared)
+                free(ctx.summary);
+        shmres_close(&ctx.shm);
+        fpt_free(&ctx.hist);
 }
 
 /* vytvorí cestu k socketu podľa PID */
@@ -336,19 +690,50 @@ static void server_sock_from_pid(char *out, size_t n, pid_t pid)
         snprintf(out, n, "/tmp/sim_%d.sock", (int)pid);
 }
 
-/* spustí server ako nový proces */
+/* spustí server ako nový proces; SIM_LISTEN=tcp:host:port mu pridá aj TCP socket;
+   vráti sa, až keď server počúva (cez rúru SIM_READY_FD), -1 ak nenaštartoval */
 static pid_t start_server(char *sock_out, size_t n)
 {
+        const char *tcp = getenv("SIM_LISTEN");
+
+        /* zápisový koniec dostane server, čítací sa pri exec zavrie */
+        int ready[2];
+        if (pipe(ready) != 0)
+                return -1;
+        fcntl(ready[0], F_SETFD, FD_CLOEXEC);
+
         pid_t pid = fork();
         if (pid == 0) {
-                execl("./server", "./server", NULL);
+                char fd_str[16];
+                snprintf(fd_str, sizeof(fd_str), "%d", ready[1]);
+                setenv("SIM_READY_FD", fd_str, 1);
+
+                if (tcp && tcp[0])
+                        execl("./server", "./server", tcp, NULL);
+                else
+                        execl("./server", "./server", NULL);
                 _exit(1);
         }
-        if (pid < 0)
+        close(ready[1]);
+        if (pid < 0) {
+                close(ready[0]);
                 return -1;
+        }
+
+        /* server zapíše bajt, keď počúva; koniec rúry bez neho = skončil skôr */
+        char c;
+        ssize_t r;
+        do {
+                r = read(ready[0], &c, 1);
+        } while (r < 0 && errno == EINTR);
+        close(ready[0]);
+
+        if (r != 1) {
+                waitpid(pid, NULL, 0);
+                return -1;
+        }
 
         server_sock_from_pid(sock_out, n, pid);
-        sleep(1);
         return pid;
 }
 
@@ -372,6 +757,26 @@ static int ask_int(const char *prompt)
         }
 }
 
+/* načítanie 64-bitového čísla bez znamienka (seed) */
+static uint64_t ask_u64(const char *prompt)
+{
+        char line[128];
+        unsigned long long v = 0;
+
+        for (;;) {
+                printf("%s", prompt);
+                fflush(stdout);
+
+                if (!fgets(line, sizeof(line), stdin))
+                        exit(1);
+
+                if (sscanf(line, "%llu", &v) == 1)
+                        return (uint64_t)v;
+
+                printf("Invalid input, try again.\n");
+        }
+}
+
 /* načítanie double z konzoly - generované AI */
 static double ask_double(const char *prompt)
 {
@@ -425,46 +830,6 @@ static void ask_str(const char *prompt, char *out, size_t n)
         }
 }
 
-/* zistí WIDTH/HEIGHT zo súboru (kvôli load módu) */
-static int parse_width_height_from_file(const char *path, int *w_out, int *h_out)
-{
-        FILE *f = fopen(path, "r");
-        if (!f)
-                return -1;
-
-        char key[64];
-        int w = 0, h = 0;
-
-        /* stačí pár riadkov, hľadáme len WIDTH a HEIGHT */
-        for (int i = 0; i < 32; i++) {
-                if (fscanf(f, "%63s", key) != 1)
-                        break;
-
-                if (strcmp(key, "WIDTH") == 0) {
-                        if (fscanf(f, "%d", &w) != 1)
-                                break;
-                } else if (strcmp(key, "HEIGHT") == 0) {
-                        if (fscanf(f, "%d", &h) != 1)
-                                break;
-                } else {
-                        char skipline[512];
-                        fgets(skipline, sizeof(skipline), f);
-                }
-
-                if (w > 0 && h > 0)
-                        break;
-        }
-
-        fclose(f);
-
-        if (w <= 0 || h <= 0)
-                return -1;
-
-        *w_out = w;
-        *h_out = h;
-        return 0;
-}
-
 /* hlavička menu */
 static void menu_header(void)
 {
@@ -510,10 +875,53 @@ static void menu_new(void)
         else
                 cfg.obstacle_density = 0.0;
 
-        cfg.mode = (sim_mode_t)ask_int("Mode (1=interactive, 2=summary): ");
-        if (cfg.mode != SIM_MODE_SUMMARY)
+        cfg.mode = (sim_mode_t)ask_int("Mode (1=interactive, 2=summary, 3=exact): ");
+        if (cfg.mode != SIM_MODE_SUMMARY && cfg.mode != SIM_MODE_EXACT)
                 cfg.mode = SIM_MODE_INTERACTIVE;
 
+        cfg.threads = ask_int("Threads (0 = auto): ");
+        if (cfg.threads < 0)
+                cfg.threads = 0;
+
+        cfg.seed = ask_u64("Seed (0 = random): ");
+
+        if (cfg.mode != SIM_MODE_INTERACTIVE) {
+                cfg.layout = ask_int("Memory layout (0 = rows, 1 = tiled 8x8, 2 = morton): ");
+                if (cfg.layout < GRID_LAYOUT_ROWS || cfg.layout > GRID_LAYOUT_MORTON)
+                        cfg.layout = GRID_LAYOUT_ROWS;
+        }
+
+        if (cfg.mode == SIM_MODE_SUMMARY) {
+                int fr = ask_int("First replication index (0 = default, >0 for a split run to merge later): ");
+                cfg.first_rep = fr > 0 ? (uint32_t)fr : 0;
+
+                cfg.adaptive = ask_int("Adaptive replications (0 = no, 1 = yes): ") == 1;
+                if (cfg.adaptive)
+                        cfg.ci_tolerance = ask_double("CI half-width tolerance (e.g. 0.01): ");
+                if (!cfg.adaptive) {
+                        cfg.workers = ask_int("Worker processes (0 = single process): ");
+                        if (cfg.workers < 0)
+                                cfg.workers = 0;
+                }
+                cfg.deadline_sec = (uint32_t)ask_int("Deadline in seconds (0 = none): ");
+                cfg.jump = ask_int("Multi-step jumps (0 = no, 1 = yes): ") == 1;
+
+                int hw = ask_int("First-passage histogram bucket width in steps (0 = none): ");
+                cfg.hist_width = hw > 0 ? (uint32_t)hw : 0;
+
+                int sr = ask_int("Live summary every N replications (0 = off): ");
+                cfg.snapshot_reps = sr > 0 ? (uint32_t)sr : 0;
+                int sm = ask_int("Live summary every T ms (0 = off, min 100): ");
+                cfg.snapshot_ms = sm > 0 ? (uint32_t)(sm < 100 ? 100 : sm) : 0;
+
+                if (cfg.workers == 0) {
+                        int cs = ask_int("Checkpoint every N seconds (0 = off): ");
+                        cfg.checkpoint_sec = cs > 0 ? (uint32_t)cs : 0;
+                        if (cfg.checkpoint_sec > 0)
+                                ask_str("Checkpoint file: ", cfg.checkpoint_file, sizeof(cfg.checkpoint_file));
+                }
+        }
+
         ask_str("Output file: ", cfg.output_file, sizeof(cfg.output_file));
 
         char sock[108];
@@ -542,7 +950,7 @@ static void menu_load(void)
         ask_str("Input file: ", cfg.input_file, sizeof(cfg.input_file));
 
         int w = 0, h = 0;
-        if (parse_width_height_from_file(cfg.input_file, &w, &h) != 0) {
+        if (simulation_size(cfg.input_file, &w, &h) != 0) {
             printf("\n[CLIENT] failed to parse WIDTH/HEIGHT from file\n");
             printf("Press Enter...\n");
             getchar();
@@ -568,15 +976,54 @@ static void menu_load(void)
         run_client(&cfg, sock, 1);
 }
 
-/* menu: pripojenie na existujúci server podľa PID */
-static void menu_connect(void)
+/* menu: pokračovanie prerušeného výpočtu z checkpointu */
+static void menu_resume(void)
 {
         menu_header();
 
-        int pid = ask_int("Enter server PID to connect: ");
+        config cfg;
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.start_type = SIM_RESUME;
+        cfg.mode = SIM_MODE_SUMMARY;
+
+        ask_str("Checkpoint file: ", cfg.input_file, sizeof(cfg.input_file));
+
+        int w = 0, h = 0;
+        if (simulation_size(cfg.input_file, &w, &h) != 0) {
+                printf("\n[CLIENT] failed to parse WIDTH/HEIGHT from checkpoint\n");
+                printf("Press Enter...\n");
+                getchar();
+                return;
+        }
+
+        cfg.world_width = w;
+        cfg.world_height = h;
+
+        ask_str("Output file: ", cfg.output_file, sizeof(cfg.output_file));
 
         char sock[108];
-        server_sock_from_pid(sock, sizeof(sock), (pid_t)pid);
+        pid_t pid = start_server(sock, sizeof(sock));
+        if (pid < 0) {
+                printf("[CLIENT] failed to start server\n");
+                return;
+        }
+
+        printf("\n[CLIENT] server started (pid=%d)\n", (int)pid);
+        printf("[CLIENT] connecting automatically: %s\n\n", sock);
+
+        run_client(&cfg, sock, 1);
+}
+
+/* menu: pripojenie na existujúci server podľa PID (lokálne) alebo adresy (tcp:host:port) */
+static void menu_connect(void)
+{
+        menu_header();
+
+        char sock[256];
+        ask_str("Server PID or address (tcp:host:port): ", sock, sizeof(sock));
+
+        if (strspn(sock, "0123456789") == strlen(sock))
+                server_sock_from_pid(sock, sizeof(sock), (pid_t)atoi(sock));
 
         config dummy;
         memset(&dummy, 0, sizeof(dummy));
@@ -597,8 +1044,9 @@ int main(void)
                 menu_header();
                 printf("1) New simulation\n");
                 printf("2) Load simulation from file\n");
-                printf("3) Connect to running server (by PID)\n");
-                printf("4) Quit\n\n");
+                printf("3) Resume from checkpoint\n");
+                printf("4) Connect to running server (PID or tcp:host:port)\n");
+                printf("5) Quit\n\n");
 
                 int choice = ask_int("Choice: ");
 
@@ -607,8 +1055,10 @@ int main(void)
                 else if (choice == 2)
                         menu_load();
                 else if (choice == 3)
-                        menu_connect();
+                        menu_resume();
                 else if (choice == 4)
+                        menu_connect();
+                else if (choice == 5)
                         return 0;
                 else
                         printf("Invalid choice\n");
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "persist.h"
+#include "grid.h"
+#include "bitmap.h"
+#include "fpt.h"
+
+/* spojí výsledky viacerých behov tej istej úlohy do jedného súboru:
+   sčíta surové počty (zásahy, kroky, replikácie) a z nich prepočíta summary;
+   behy musia mať ten istý seed a replikácie musia nadväzovať bez medzier,
+   aby výsledok presne popísal rozsah first_rep..first_rep+replications
+   použitie: merge VÝSTUP VSTUP1 VSTUP2 ... */
+
+/* jeden načítaný súbor */
+typedef struct {
+        const char *path;
+        config cfg;
+        uint64_t *obstacles;
+        msg_sum_cell_t *summary;
+        uint32_t *reps_used;
+        uint64_t *hits;
+        uint64_t *steps_sum;
+        fpt_hist_t hist;
+        sim_mapping_t map;      /* binárny súbor: polia ukazujú do mapovania */
+} run_t;
+
+static void run_free(run_t *r)
+{
+        if (r->map.base) {
+                unmap_simulation(&r->map);
+                return;
+        }
+        free(r->obstacles);
+        free(r->summary);
+        free(r->reps_used);
+        free(r->hits);
+        free(r->steps_sum);
+        fpt_free(&r->hist);
+}
+
+/* behy musia simulovať ten istý svet s rovnakými parametrami */
+static int compatible(const run_t *a, const run_t *b)
+{
+        if (a->cfg.world_width != b->cfg.world_width || a->cfg.world_height != b->cfg.world_height) {
+                fprintf(stderr, "%s: different world size than %s\n", b->path, a->path);
+                return 0;
+        }
+        if (a->cfg.max_steps != b->cfg.max_steps) {
+                fprintf(stderr, "%s: different K than %s\n", b->path, a->path);
+                return 0;
+        }
+        if (memcmp(&a->cfg.probs, &b->cfg.probs, sizeof(a->cfg.probs)) != 0) {
+                fprintf(stderr, "%s: different probabilities than %s\n", b->path, a->path);
+                return 0;
+        }
+
+        /* výsledný súbor má jeden seed, iný by sa v ňom stratil */
+        if (a->cfg.seed != b->cfg.seed) {
+                fprintf(stderr, "%s: different seed than %s\n", b->path, a->path);
+                return 0;
+        }
+
+        /* prekážky sa porovnávajú po bitoch, prázdny svet = žiadne */
+        size_t cells = grid_cells(&a->cfg);
+        int a_obs = a->obstacles != NULL;
+        int b_obs = b->obstacles != NULL;
+        if (a_obs != b_obs ||
+            (a_obs && memcmp(a->obstacles, b->obstacles, bitmap_bytes(cells)) != 0)) {
+                fprintf(stderr, "%s: different obstacles than %s\n", b->path, a->path);
+                return 0;
+        }
+        return 1;
+}
+
+/* zoradí behy podľa first_rep a overí, že rozsahy replikácií nadväzujú bez medzier
+   a prekryvov (prekryv = tie isté chodci by sa započítali dvakrát, medzera = výsledok
+   by tvrdil replikácie, ktoré nemá); order dostane poradie behov */
+static int contiguous(const run_t *runs, int n, int *order)
+{
+        for (int i = 0; i < n; i++) {
+                int k = i;
+                while (k > 0 && runs[order[k - 1]].cfg.first_rep > runs[i].cfg.first_rep) {
+                        order[k] = order[k - 1];
+                        k--;
+                }
+                order[k] = i;
+        }
+
+        for (int i = 1; i < n; i++) {
+                const run_t *p = &runs[order[i - 1]];
+                const run_t *r = &runs[order[i]];
+                uint64_t p_end = (uint64_t)p->cfg.first_rep + p->cfg.replications;
+                if (r->cfg.first_rep != p_end) {
+                        fprintf(stderr, "%s: replications [%u, %llu) %s %s [%u, %llu)\n", r->path,
+                                (unsigned)r->cfg.first_rep,
+                                (unsigned long long)r->cfg.first_rep + r->cfg.replications,
+                                r->cfg.first_rep < p_end ? "overlap" : "leave a gap after",
+                                p->path, (unsigned)p->cfg.first_rep, (unsigned long long)p_end);
+                        return 0;
+                }
+        }
+        return 1;
+}
+
+int main(int argc, char **argv)
+{
+        if (argc < 4) {
+                fprintf(stderr, "usage: %s OUTPUT INPUT1 INPUT2 [INPUT...]\n", argv[0]);
+                return 1;
+        }
+
+        int n = argc - 2;
+        run_t *runs = calloc((size_t)n, sizeof(*runs));
+        int *order = calloc((size_t)n, sizeof(*order));
+        if (!runs || !order) {
+                free(runs);
+                free(order);
+                return 1;
+        }
+
+        int rc = 1;
+        int loaded = 0;
+        for (int i = 0; i < n; i++) {
+                run_t *r = &runs[i];
+                r->path = argv[i + 2];
+
+                if (load_simulation(r->path, &r->cfg, &r->obstacles, &r->summary, &r->reps_used,
+                                    &r->hits, &r->steps_sum, &r->hist, &r->map) != 0) {
+                        fprintf(stderr, "%s: cannot load\n", r->path);
+                        goto out;
+                }
+                loaded++;
+
+                /* presný výpočet a staršie súbory nemajú čo sčítať */
+                if (!r->hits || !r->steps_sum || !r->reps_used) {
+                        fprintf(stderr, "%s: no raw counters (exact run or older file)\n", r->path);
+                        goto out;
+                }
+
+                if (i > 0 && !compatible(&runs[0], r))
+                        goto out;
+        }
+
+        if (!contiguous(runs, n, order))
+                goto out;
+
+        /* výsledok má config prvého súboru so súčtom replikácií od najnižšej first_rep */
+        run_t *m = &runs[0];
+        size_t cells = grid_cells(&m->cfg);
+        uint64_t replications = m->cfg.replications;
+        uint32_t first_rep = runs[order[0]].cfg.first_rep;
+
+        /* histogram ostane, len ak ho majú všetky behy s rovnakými košmi */
+        int keep_hist = m->hist.cells > 0;
+
+        for (int i = 1; i < n; i++) {
+                const run_t *r = &runs[i];
+
+                replications += r->cfg.replications;
+
+                for (size_t c = 0; c < cells; c++) {
+                        if ((uint64_t)m->reps_used[c] + r->reps_used[c] > UINT32_MAX) {
+                                fprintf(stderr, "%s: replication count overflow\n", r->path);
+                                goto out;
+                        }
+                        m->hits[c] += r->hits[c];
+                        m->steps_sum[c] += r->steps_sum[c];
+                        m->reps_used[c] += r->reps_used[c];
+                }
+
+                if (keep_hist && (r->hist.cells != m->hist.cells || r->hist.width != m->hist.width)) {
+                        fprintf(stderr, "%s: no matching first-passage histogram, dropping it\n", r->path);
+                        keep_hist = 0;
+                }
+                if (keep_hist) {
+                        size_t nb = (size_t)m->hist.cells * m->hist.buckets;
+                        for (size_t k = 0; k < nb; k++) {
+                                m->hist.hits[k] += r->hist.hits[k];
+                                m->hist.steps[k] += r->hist.steps[k];
+                        }
+                }
+        }
+
+        if (replications > UINT32_MAX) {
+                fprintf(stderr, "replication count overflow\n");
+                goto out;
+        }
+        m->cfg.replications = (uint32_t)replications;
+        m->cfg.first_rep = first_rep;
+
+        if (keep_hist)
+                memcpy(m->hist.reps, m->reps_used, cells * sizeof(uint32_t));
+
+        summary_from_counters(&m->cfg, m->hits, m->steps_sum, m->reps_used, m->summary);
+
+        if (save_simulation(argv[1], &m->cfg, m->obstacles, m->summary, m->reps_used,
+                            m->hits, m->steps_sum, keep_hist ? &m->hist : NULL) != 0) {
+                fprintf(stderr, "%s: cannot save\n", argv[1]);
+                goto out;
+        }
+
+        printf("merged %d runs: %u replications -> %s\n", n, (unsigned)m->cfg.replications, argv[1]);
+        rc = 0;
+
+out:
+        for (int i = 0; i < loaded; i++)
+                run_free(&runs[i]);
+        free(runs);
+        free(order);
+        return rc;
+}
@@ -3,125 +3,162 @@
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
-#include <sys/socket.h>
-#include <time.h>
 #include <stdint.h>
-#include <errno.h>
+#include <signal.h>
+#include <sys/resource.h>
 
 #include "net.h"
 #include "protocol.h"
 #include "config.h"
 #include "persist.h"
-
-#define MAX_CLIENTS 16
-
-/* zoznam klientov */
+#include "grid.h"
+#include "engine.h"
+#include "shard.h"
+#include "rng.h"
+#include "walk.h"
+#include "exact.h"
+#include "fpt.h"
+#include "bitmap.h"
+#include "outq.h"
+#include "shmres.h"
+
+/* zapisovač checkpointov na pozadí, aby výpočet nečakal na disk */
 typedef struct {
-        int fds[MAX_CLIENTS];
-        int count;
+        pthread_t tid;
         pthread_mutex_t mtx;
-} clients_t;
+        pthread_cond_t cond;
+        int pending;            /* 1 = kópia čaká na zápis alebo sa práve zapisuje */
+        int stop;
+        checkpoint_t ck;        /* kópia stavu po riadkoch (obstacles patria serveru) */
+} ckpt_writer_t;
 
 /* stav servera */
 typedef struct {
         config cfg;
-        int cfg_set;
 
+        /* príchod configu a koniec výpočtu (pod state_mtx, state_cond = prišiel config) */
+        pthread_mutex_t state_mtx;
+        pthread_cond_t state_cond;
+        int cfg_set;
         int done;
         msg_sum_cell_t *summary_cells;
 
-        uint8_t *obstacles;
+        uint64_t *obstacles;    /* bitová mapa prekážok (bitmap.h), NULL pri prázdnom svete */
+
+        rng_t rng;              /* prúd pre prekážky a interaktívny režim */
+        grid_nbr_t nbr;         /* susedia políčok, postavené po vygenerovaní prekážok */
+        uint32_t *reps_used;    /* replikácie na políčko (NULL = všade cfg.replications) */
+        uint64_t *hits;         /* surové počty Monte Carlo (NULL pri presnom výpočte) */
+        uint64_t *steps_sum;
+        uint32_t *dist;         /* najkratšia cesta do [0,0] okolo prekážok (z BFS) */
+        fpt_hist_t hist;        /* časy príchodu po košoch (hist.cells == 0 = nie sú) */
+        sim_mapping_t map;      /* načítaný binárny súbor; polia výsledkov potom ukazujú doň */
 
-        clients_t clients;
+        /* priebežné summary počas výpočtu (pod live_mtx) */
+        pthread_mutex_t live_mtx;
+        msg_sum_cell_t *live;   /* naposledy rozoslané hodnoty po riadkoch, NULL = nebeží */
+        msg_delta_hdr_t live_hdr;
+
+        ckpt_writer_t ckpt;
+
+        outq_t out;             /* fronty klientov, posiela z nich I/O vlákno */
+
+        /* správy zakódované raz, neskorší klienti dostanú tie isté (pod msg_mtx) */
+        pthread_mutex_t msg_mtx;
+        outq_buf_t *obstacles_msg;
+        outq_buf_t *summary_msg;
+        outq_buf_t *hist_msg;
+        outq_buf_t *shm_msg;    /* MSG_SHM_READY s fd segmentu pre klientov cez UNIX socket */
+        uint32_t shm_flags;     /* čo je v segmente zverejnené (MSG_SHM_HAS_*) */
+
+        /* prekážky a summary v zdieľanej pamäti (shm.fd < 0 = ešte nie je) */
+        shmres_t shm;
+        int shm_on;             /* 0 = SIM_SHM=0 alebo segment nejde vytvoriť */
 
         pthread_t sim_tid;
-        pthread_t accept_tid;
         int listen_fd;
+        int tcp_fd;             /* -1 = len UNIX socket */
         char sock_path[108];
 } server_t;
 
-/* zapíše presne len bajtov na socket - generované a odporúčené AI */
-static int write_full(int fd, const void *buf, size_t len)
+/* rozpracovaná správa MSG_SUMMARY_DELTA */
+typedef struct {
+        uint8_t *buf;           /* msg_delta_hdr_t, za ňou políčka */
+        size_t count;
+        size_t cap;
+        int failed;
+} delta_buf_t;
+
+/* pridá políčko do správy (pri chybe pamäte sa správa neodošle) */
+static void delta_add(delta_buf_t *d, uint32_t index, msg_sum_cell_t cell)
 {
-        const uint8_t *bytes = (const uint8_t *)buf;
-        size_t sent = 0;
+        if (d->failed)
+                return;
 
-        while (sent < len) {
-                /* MSG_NOSIGNAL aby server nespadol na SIGPIPE */
-                ssize_t n = send(fd, bytes + sent, len - sent, MSG_NOSIGNAL);
-                if (n < 0) {
-                        if (errno == EINTR)
-                                continue; /* signál -> skús znova */
-                        return -1;
+        if (d->count == d->cap) {
+                size_t cap = d->cap ? d->cap * 2 : 1024;
+                uint8_t *b = realloc(d->buf, sizeof(msg_delta_hdr_t) + cap * sizeof(msg_delta_cell_t));
+                if (!b) {
+                        d->failed = 1;
+                        return;
                 }
-                if (n == 0)
-                        return -1;
-                sent += (size_t)n;
+                d->buf = b;
+                d->cap = cap;
         }
-        return 0;
+
+        msg_delta_cell_t c;
+        c.index = index;
+        c.reserved = 0;
+        c.cell = cell;
+        memcpy(d->buf + sizeof(msg_delta_hdr_t) + d->count * sizeof(c), &c, sizeof(c));
+        d->count++;
 }
 
-/* prečíta presne len bajtov (1 = OK, 0 = EOF, -1 = chyba) - generované a odporúčené AI */
-static int read_full(int fd, void *buf, size_t len)
+/* doplní hlavičku správy, vráti jej dĺžku (0 = nie je čo poslať) */
+static uint64_t delta_finish(server_t *s, delta_buf_t *d)
 {
-        uint8_t *bytes = (uint8_t *)buf;
-        size_t got = 0;
+        if (d->failed || d->count == 0)
+                return 0;
 
-        while (got < len) {
-                ssize_t n = recv(fd, bytes + got, len - got, 0);
-                if (n < 0) {
-                        if (errno == EINTR)
-                                continue;
-                        return -1;
-                }
-                if (n == 0)
-                        return 0; /* klient sa odpojil */
-                got += (size_t)n;
-        }
-        return 1;
+        msg_delta_hdr_t hdr = s->live_hdr;
+        hdr.count = (uint32_t)d->count;
+        memcpy(d->buf, &hdr, sizeof(hdr));
+        return sizeof(hdr) + (uint64_t)d->count * sizeof(msg_delta_cell_t);
 }
 
-/* pridá klienta do zoznamu (ak je plno, zavrie ho) */
-static void clients_add(clients_t *c, int fd)
+/* celý priebežný stav oproti nulám, z ktorých klient začína (pod live_mtx) */
+static void delta_all(server_t *s, delta_buf_t *d)
 {
-        pthread_mutex_lock(&c->mtx);
-        if (c->count < MAX_CLIENTS)
-                c->fds[c->count++] = fd;
-        else
-                close(fd);
-        pthread_mutex_unlock(&c->mtx);
+        size_t total = grid_cells(&s->cfg);
+        for (size_t i = 0; i < total; i++)
+                if (s->live[i].avg_steps != 0.0 || s->live[i].probability != 0.0)
+                        delta_add(d, (uint32_t)i, s->live[i]);
 }
 
-/* odstráni klienta na indexe (posunie pole) */
-static void clients_remove_at(clients_t *c, int idx)
+/* celý stav pre klientov, ktorí delty nestíhali (volá outq pod live_mtx) */
+static void *live_full(void *user, uint64_t *len)
 {
-        close(c->fds[idx]);
-        for (int i = idx; i < c->count - 1; i++)
-                c->fds[i] = c->fds[i + 1];
-        c->count--;
+        server_t *s = (server_t *)user;
+        delta_buf_t d;
+        memset(&d, 0, sizeof(d));
+
+        delta_all(s, &d);
+        *len = delta_finish(s, &d);
+        if (*len == 0) {
+                free(d.buf);
+                return NULL;
+        }
+        return d.buf;
 }
 
-/* pošle správu všetkým klientom */
-static void broadcast(server_t *s, msg_type_t type, const void *payload, uint32_t size)
+/* pošle správu jednému klientovi (fd >= 0) alebo všetkým (fd < 0) */
+static void delta_send(server_t *s, delta_buf_t *d, int fd)
 {
-        msg_header_t hdr;
-        hdr.type = type;
-        hdr.size = size;
-
-        /* zamkneme, aby sa zoznam klientov nemenil počas posielania */
-        pthread_mutex_lock(&s->clients.mtx);
-        for (int i = 0; i < s->clients.count; ) {
-                int client_fd = s->clients.fds[i];
-
-                /* ak zlyhá posielanie, klienta vyhodíme */
-                if (write_full(client_fd, &hdr, sizeof(hdr)) != 0 ||
-                    (size > 0 && write_full(client_fd, payload, size) != 0)) {
-                        clients_remove_at(&s->clients, i);
-                        continue;
-                }
-                i++;
-        }
-        pthread_mutex_unlock(&s->clients.mtx);
+        uint64_t len = delta_finish(s, d);
+        if (len > 0)
+                outq_delta(&s->out, fd, d->buf, len, live_full, s);
+        free(d->buf);
+        memset(d, 0, sizeof(*d));
 }
 
 /* pomocná: je to kladné nepárne číslo? */
@@ -138,9 +175,17 @@ static int validate_cfg(const config *cfg)
                 if (!is_odd_positive(cfg->world_width) || !is_odd_positive(cfg->world_height))
                         return 0;
 
+                /* indexy políčok sú 32-bitové */
+                if ((uint64_t)cfg->world_width * (uint64_t)cfg->world_height > GRID_MAX_CELLS)
+                        return 0;
+
                 if (cfg->replications == 0 || cfg->max_steps == 0)
                         return 0;
 
+                /* indexy replikácií sú 32-bitové aj s posunom */
+                if ((uint64_t)cfg->first_rep + cfg->replications > UINT32_MAX)
+                        return 0;
+
                 /* súčet pravdepodobností približne 1.0 */
                 double sum = cfg->probs.p_up + cfg->probs.p_down + cfg->probs.p_left + cfg->probs.p_right;
                 if (sum < 0.999 || sum > 1.001)
@@ -150,6 +195,31 @@ static int validate_cfg(const config *cfg)
                 if (cfg->probs.p_up < 0 || cfg->probs.p_down < 0 || cfg->probs.p_left < 0 || cfg->probs.p_right < 0)
                         return 0;
 
+                if (cfg->threads < 0 || cfg->threads > 1024)
+                        return 0;
+
+                if (cfg->adaptive && (cfg->ci_tolerance <= 0.0 || cfg->ci_tolerance >= 1.0))
+                        return 0;
+
+                if (cfg->jump != 0 && cfg->jump != 1)
+                        return 0;
+
+                if (cfg->layout < GRID_LAYOUT_ROWS || cfg->layout > GRID_LAYOUT_MORTON)
+                        return 0;
+
+                /* priebežné summary nesmie zahltiť klientov */
+                if (cfg->snapshot_ms > 0 && cfg->snapshot_ms < 100)
+                        return 0;
+
+                if (cfg->checkpoint_sec > 0 && cfg->checkpoint_file[0] == '\0')
+                        return 0;
+
+                /* procesy si vymieňajú len hotové rozsahy, adaptivita a checkpoint potrebujú stav medzi dávkami */
+                if (cfg->workers < 0 || cfg->workers > 256 ||
+                    (cfg->workers > 0 && (cfg->adaptive || cfg->checkpoint_sec > 0)))
+                        return 0;
+
+
                 /* limity na hustotu prekážok */
                 if (cfg->world_type == WORLD_OBSTACLES) {
                         if (cfg->obstacle_density < 0.0 || cfg->obstacle_density > 0.6)
@@ -158,6 +228,10 @@ static int validate_cfg(const config *cfg)
                 return 1;
         }
 
+        /* pokračovanie: config aj stav sú v checkpointe */
+        if (cfg->start_type == SIM_RESUME)
+                return cfg->input_file[0] != '\0';
+
         if (cfg->start_type == SIM_LOAD) {
                 /* pri LOAD musí byť zadaný vstupný súbor */
                 if (cfg->input_file[0] == '\0')
@@ -168,36 +242,6 @@ static int validate_cfg(const config *cfg)
         return 0;
 }
 
-/* náhodné číslo v <0,1) */
-static double rnd01(void)
-{
-        return (double)rand() / ((double)RAND_MAX + 1.0);
-}
-
-/* wrap súradníc na okraje sveta - toto mi odporúčilo psraviť AI, bez generovania kodu */
-static void wrap_xy(const config *cfg, int *x, int *y)
-{
-        int min_x = -(cfg->world_width / 2);
-        int max_x = +(cfg->world_width / 2);
-        int min_y = -(cfg->world_height / 2);
-        int max_y = +(cfg->world_height / 2);
-
-        if (*x < min_x) *x = max_x;
-        if (*x > max_x) *x = min_x;
-        if (*y < min_y) *y = max_y;
-        if (*y > max_y) *y = min_y;
-}
-
-/* prepočet (x,y) na index do 1D poľa */
-static int idx_of(const config *cfg, int x, int y)
-{
-        int ox = cfg->world_width / 2;
-        int oy = cfg->world_height / 2;
-        int ix = x + ox;
-        int iy = (oy - y);
-        return iy * cfg->world_width + ix;
-}
-
 /* zistí, či je na pozícii prekážka */
 static int is_obstacle(const server_t *s, int x, int y)
 {
@@ -205,114 +249,39 @@ static int is_obstacle(const server_t *s, int x, int y)
                 return 0;
         if (!s->obstacles)
                 return 0;
-        return s->obstacles[idx_of(&s->cfg, x, y)] != 0;
+        return bitmap_get(s->obstacles, (size_t)grid_idx_of(&s->cfg, x, y));
 }
 
-/* spraví jeden krok chodca (ak je prekážka, ostane) */
-static void step_one(server_t *s, int *x, int *y)
+/* spraví jeden krok chodca cez tabuľku susedov (prekážky sú v nej už zahrnuté) */
+static uint32_t step_one(server_t *s, uint32_t id)
 {
-        double r = rnd01();
-        double a = s->cfg.probs.p_up;
-        double b = a + s->cfg.probs.p_down;
-        double c = b + s->cfg.probs.p_left;
-
-        int nx = *x;
-        int ny = *y;
-
-        if (r < a)
-                ny++;
-        else if (r < b)
-                ny--;
-        else if (r < c)
-                nx--;
-        else
-                nx++;
-
-        /* wrapneme do sveta */
-        wrap_xy(&s->cfg, &nx, &ny);
-
-        /* ak je tam prekážka, tak sa nepresunieme */
-        if (!is_obstacle(s, nx, ny)) {
-                *x = nx;
-                *y = ny;
-        }
+        int dir = grid_dir_of(&s->cfg.probs, rng_next01(&s->rng));
+        return s->nbr.next[4 * (size_t)id + (size_t)dir];
 }
 
 /* overí, že všetky voľné políčka sú dosiahnuteľné z (0,0)
-   (BFS cez wrapnutý svet) - tu mi AI pomohlo opraviť 2 errory počas tvorby tejto funkcie */
+   (BFS cez wrapnutý svet); vzdialenosti z BFS si nechá v s->dist pre engine */
 static int validate_obstacles(server_t *s)
 {
-        int w = s->cfg.world_width;
-        int h = s->cfg.world_height;
-        int total = w * h;
-
-        uint8_t *vis = calloc((size_t)total, 1);
-        int *qx = malloc((size_t)total * sizeof(int));
-        int *qy = malloc((size_t)total * sizeof(int));
-        if (!vis || !qx || !qy) {
-                free(vis);
-                free(qx);
-                free(qy);
-                return 0;
-        }
+        size_t total = grid_cells(&s->cfg);
 
         /* cieľ [0,0] nesmie byť prekážka */
-        if (is_obstacle(s, 0, 0)) {
-                free(vis);
-                free(qx);
-                free(qy);
+        if (is_obstacle(s, 0, 0))
                 return 0;
-        }
-
-        /* BFS fronta */
-        int head = 0, tail = 0;
-        qx[tail] = 0;
-        qy[tail] = 0;
-        tail++;
-
-        vis[idx_of(&s->cfg, 0, 0)] = 1;
-
-        while (head < tail) {
-                int x = qx[head];
-                int y = qy[head];
-                head++;
-
-                static const int dx[4] = {1, -1, 0, 0};
-                static const int dy[4] = {0, 0, 1, -1};
-
-                for (int i = 0; i < 4; i++) {
-                        int nx = x + dx[i];
-                        int ny = y + dy[i];
-
-                        wrap_xy(&s->cfg, &nx, &ny);
 
-                        int id = idx_of(&s->cfg, nx, ny);
-                        if (vis[id])
-                                continue;
-                        if (is_obstacle(s, nx, ny))
-                                continue;
+        if (!s->dist)
+                s->dist = malloc(total * sizeof(uint32_t));
+        if (!s->dist)
+                return 0;
 
-                        vis[id] = 1;
-                        qx[tail] = nx;
-                        qy[tail] = ny;
-                        tail++;
-                }
-        }
+        long reached = grid_bfs_dist(&s->cfg, s->obstacles, s->dist);
+        if (reached < 0)
+                return 0;
 
         /* ak existuje voľné políčko, ktoré BFS nevidelo -> zlé prekážky */
-        for (int i = 0; i < total; i++) {
-                if (s->obstacles[i] == 0 && vis[i] == 0) {
-                        free(vis);
-                        free(qx);
-                        free(qy);
-                        return 0;
-                }
-        }
+        long free_cells = (long)(total - bitmap_count(s->obstacles, total));
 
-        free(vis);
-        free(qx);
-        free(qy);
-        return 1;
+        return reached == free_cells;
 }
 
 /* náhodne vygeneruje prekážky podľa obstacle_density */
@@ -320,10 +289,9 @@ static void generate_obstacles(server_t *s)
 {
         int w = s->cfg.world_width;
         int h = s->cfg.world_height;
-        int total = w * h;
 
         free(s->obstacles);
-        s->obstacles = calloc((size_t)total, 1);
+        s->obstacles = bitmap_alloc(grid_cells(&s->cfg));
         if (!s->obstacles)
                 return;
 
@@ -336,18 +304,30 @@ static void generate_obstacles(server_t *s)
                 for (int x = min_x; x <= max_x; x++) {
                         if (x == 0 && y == 0)
                                 continue; /* cieľ necháme voľný */
-                        if (rnd01() < s->cfg.obstacle_density)
-                                s->obstacles[idx_of(&s->cfg, x, y)] = 1;
+                        if (rng_next01(&s->rng) < s->cfg.obstacle_density)
+                                bitmap_set(s->obstacles, (size_t)grid_idx_of(&s->cfg, x, y));
                 }
         }
 }
 
+/* vzdialenosti do [0,0] pre prázdny svet */
+static void compute_dist(server_t *s)
+{
+        free(s->dist);
+        s->dist = malloc(grid_cells(&s->cfg) * sizeof(uint32_t));
+        if (s->dist && grid_bfs_dist(&s->cfg, NULL, s->dist) < 0) {
+                free(s->dist);
+                s->dist = NULL;
+        }
+}
+
 /* zabezpečí, že prekážky budú "OK", inak fallback na prázdny svet */
 static void ensure_obstacles(server_t *s)
 {
         if (s->cfg.world_type != WORLD_OBSTACLES) {
                 free(s->obstacles);
                 s->obstacles = NULL;
+                compute_dist(s);
                 return;
         }
 
@@ -365,252 +345,709 @@ static void ensure_obstacles(server_t *s)
         s->cfg.world_type = WORLD_EMPTY;
         free(s->obstacles);
         s->obstacles = NULL;
+        compute_dist(s);
+}
+
+/* výpis priebehu po každej dávke replikácií */
+static void report_progress(void *user, uint32_t reps_done, uint64_t cells_active)
+{
+        server_t *s = (server_t *)user;
+
+        if (s->cfg.adaptive)
+                printf("[SERVER] replication %u / %u done (%llu cells still running)\n",
+                        (unsigned)reps_done, (unsigned)s->cfg.replications, (unsigned long long)cells_active);
+        else
+                printf("[SERVER] replication %u / %u done\n", (unsigned)reps_done, (unsigned)s->cfg.replications);
+}
+
+/* odhad jedného políčka z počtov zásahov a krokov */
+static msg_sum_cell_t cell_estimate(uint64_t hits, uint64_t steps_sum, uint32_t reps)
+{
+        msg_sum_cell_t c;
+        c.probability = 0.0;
+        if (reps > 0)
+                c.probability = (double)hits / (double)reps;
+        c.avg_steps = 0.0;
+        if (hits > 0)
+                c.avg_steps = (double)steps_sum / (double)hits;
+        return c;
+}
+
+/* priebežný stav z enginu: rozošle len políčka, ktoré sa od minulého stavu zmenili */
+static void publish_snapshot(void *user, const uint64_t *hits, const uint64_t *steps_sum,
+                             const uint32_t *reps_used, uint32_t reps_done, uint64_t cells_active)
+{
+        server_t *s = (server_t *)user;
+        size_t total = grid_cells(&s->cfg);
+        uint32_t origin = (uint32_t)grid_idx_of(&s->cfg, 0, 0);
+        delta_buf_t d;
+        memset(&d, 0, sizeof(d));
+
+        pthread_mutex_lock(&s->live_mtx);
+        if (!s->live) {
+                pthread_mutex_unlock(&s->live_mtx);
+                return;
+        }
+
+        /* polia z enginu sú v poradí tabuľky, klienti chcú indexy po riadkoch */
+        for (size_t id = 0; id < total; id++) {
+                uint32_t row = grid_nbr_row(&s->nbr, (uint32_t)id);
+                msg_sum_cell_t v;
+                if (row == origin) {
+                        v.avg_steps = 0.0;
+                        v.probability = 1.0;
+                } else {
+                        v = cell_estimate(hits[id], steps_sum[id], reps_used[id]);
+                }
+
+                msg_sum_cell_t *old = &s->live[row];
+                if (v.avg_steps == old->avg_steps && v.probability == old->probability)
+                        continue;
+                *old = v;
+                delta_add(&d, row, v);
+        }
+
+        s->live_hdr.reps_done = reps_done;
+        s->live_hdr.replications = s->cfg.replications;
+        s->live_hdr.cells_active = cells_active;
+        delta_send(s, &d, -1);
+        pthread_mutex_unlock(&s->live_mtx);
+
+        printf("[SERVER] live summary after %u / %u replications\n",
+                (unsigned)reps_done, (unsigned)s->cfg.replications);
+}
+
+/* klientovi, ktorý sa pripojil počas výpočtu, pošle celý priebežný stav
+   (oproti nulám, z ktorých klient začína) */
+static void send_live_to_fd(server_t *s, int fd)
+{
+        delta_buf_t d;
+        memset(&d, 0, sizeof(d));
+
+        pthread_mutex_lock(&s->live_mtx);
+        if (s->live && s->live_hdr.reps_done > 0) {
+                delta_all(s, &d);
+                delta_send(s, &d, fd);
+        }
+        pthread_mutex_unlock(&s->live_mtx);
+}
+
+/* vlákno zapisovača: čaká na kópiu stavu a zapíše ju (atomicky cez rename) */
+static void *checkpoint_thread(void *arg)
+{
+        server_t *s = (server_t *)arg;
+        ckpt_writer_t *w = &s->ckpt;
+
+        pthread_mutex_lock(&w->mtx);
+        for (;;) {
+                while (!w->pending && !w->stop)
+                        pthread_cond_wait(&w->cond, &w->mtx);
+                if (!w->pending)
+                        break;
+                pthread_mutex_unlock(&w->mtx);
+
+                if (save_checkpoint(w->ck.cfg.checkpoint_file, &w->ck) == 0)
+                        printf("[SERVER] checkpoint after %u replications saved to %s\n",
+                                (unsigned)w->ck.state.reps_done, w->ck.cfg.checkpoint_file);
+                else
+                        printf("[SERVER] checkpoint write to %s failed\n", w->ck.cfg.checkpoint_file);
+
+                pthread_mutex_lock(&w->mtx);
+                w->pending = 0;
+        }
+        pthread_mutex_unlock(&w->mtx);
+        return NULL;
+}
+
+/* pripraví kópie polí a spustí zapisovač (0 ok, -1 pri chybe) */
+static int checkpoint_start(server_t *s)
+{
+        ckpt_writer_t *w = &s->ckpt;
+        size_t total = grid_cells(&s->cfg);
+
+        memset(w, 0, sizeof(*w));
+        w->ck.cfg = s->cfg;
+        w->ck.obstacles = (s->cfg.world_type == WORLD_OBSTACLES) ? s->obstacles : NULL;
+
+        engine_state_t *st = &w->ck.state;
+        st->hits = malloc(total * sizeof(uint64_t));
+        st->steps_sum = malloc(total * sizeof(uint64_t));
+        st->reps_used = malloc(total * sizeof(uint32_t));
+        int ok = st->hits && st->steps_sum && st->reps_used;
+        if (ok && s->cfg.adaptive) {
+                st->welford = malloc(total * 4 * sizeof(double));
+                st->retired = malloc(total);
+                ok = st->welford && st->retired;
+        }
+        if (ok && s->hist.cells > 0)
+                ok = fpt_alloc(&w->ck.hist, s->hist.cells, s->hist.origin, s->hist.max_steps, s->hist.width) == 0;
+
+        if (!ok) {
+                w->ck.obstacles = NULL;
+                checkpoint_free(&w->ck);
+                return -1;
+        }
+
+        pthread_mutex_init(&w->mtx, NULL);
+        pthread_cond_init(&w->cond, NULL);
+        if (pthread_create(&w->tid, NULL, checkpoint_thread, s) != 0) {
+                pthread_mutex_destroy(&w->mtx);
+                pthread_cond_destroy(&w->cond);
+                w->ck.obstacles = NULL;
+                checkpoint_free(&w->ck);
+                return -1;
+        }
+        return 0;
+}
+
+/* dokončí rozpísaný checkpoint a zastaví zapisovač */
+static void checkpoint_stop(server_t *s)
+{
+        ckpt_writer_t *w = &s->ckpt;
+
+        pthread_mutex_lock(&w->mtx);
+        w->stop = 1;
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->mtx);
+        pthread_join(w->tid, NULL);
+
+        pthread_mutex_destroy(&w->mtx);
+        pthread_cond_destroy(&w->cond);
+        w->ck.obstacles = NULL;
+        checkpoint_free(&w->ck);
+}
+
+/* z enginu: skopíruje stav (po riadkoch) a nechá ho zapísať na pozadí;
+   ak sa predchádzajúci ešte zapisuje, tento vynechá, aby výpočet nečakal */
+static void queue_checkpoint(void *user, const engine_state_t *st)
+{
+        server_t *s = (server_t *)user;
+        ckpt_writer_t *w = &s->ckpt;
+        size_t total = grid_cells(&s->cfg);
+
+        pthread_mutex_lock(&w->mtx);
+        int busy = w->pending;
+        pthread_mutex_unlock(&w->mtx);
+        if (busy) {
+                printf("[SERVER] previous checkpoint still being written, skipping\n");
+                return;
+        }
+
+        /* zapisovač na kópiu nesiahne, kým nie je pending */
+        engine_state_t *c = &w->ck.state;
+        for (size_t id = 0; id < total; id++) {
+                uint32_t row = grid_nbr_row(&s->nbr, (uint32_t)id);
+                c->hits[row] = st->hits[id];
+                c->steps_sum[row] = st->steps_sum[id];
+                c->reps_used[row] = st->reps_used[id];
+                if (c->welford && st->welford) {
+                        memcpy(&c->welford[4 * (size_t)row], &st->welford[4 * id], 4 * sizeof(double));
+                        c->retired[row] = st->retired[id];
+                }
+        }
+        c->reps_done = st->reps_done;
+
+        /* histogram je po riadkoch a medzi dávkami sa nemení */
+        if (w->ck.hist.cells > 0) {
+                size_t n = (size_t)s->hist.cells * s->hist.buckets;
+                memcpy(w->ck.hist.hits, s->hist.hits, n * sizeof(uint32_t));
+                memcpy(w->ck.hist.steps, s->hist.steps, n * sizeof(uint64_t));
+        }
+
+        pthread_mutex_lock(&w->mtx);
+        w->pending = 1;
+        pthread_cond_signal(&w->cond);
+        pthread_mutex_unlock(&w->mtx);
 }
 
 /* vypočíta summary pre každé políčko (pravdepodobnosť + priemer krokov) - s touto metodou mi pomohlo AI */
-static void compute_summary(server_t *s)
+static void compute_summary(server_t *s, const checkpoint_t *resume)
 {
         const config *cfg = &s->cfg;
-        int w = cfg->world_width;
-        int h = cfg->world_height;
-        int min_x = -(w / 2);
-        int max_x = +(w / 2);
-        int min_y = -(h / 2);
-        int max_y = +(h / 2);
 
         /* pomocné polia: koľkokrát trafím cieľ a súčet krokov */
-        uint64_t *hits = calloc((size_t)(w * h), sizeof(uint64_t));
-        uint64_t *steps_sum = calloc((size_t)(w * h), sizeof(uint64_t));
-        if (!hits || !steps_sum) {
+        size_t total = grid_cells(cfg);
+        uint64_t *hits = calloc(total, sizeof(uint64_t));
+        uint64_t *steps_sum = calloc(total, sizeof(uint64_t));
+        uint32_t *reps_used = calloc(total, sizeof(uint32_t));
+        if (!hits || !steps_sum || !reps_used) {
                 free(hits);
                 free(steps_sum);
+                free(reps_used);
                 return;
         }
 
-        /* Monte Carlo replikácie */
-        for (uint32_t rep = 1; rep <= cfg->replications; rep++) {
-                for (int y = min_y; y <= max_y; y++) {
-                        for (int x = min_x; x <= max_x; x++) {
-                                if (x == 0 && y == 0)
-                                        continue;
-
-                                if (is_obstacle(s, x, y))
-                                        continue;
-
-                                int cx = x;
-                                int cy = y;
-                                uint32_t steps;
-                                int hit = 0;
-
-                                /* simulácia krokov max do K */
-                                for (steps = 1; steps <= cfg->max_steps; steps++) {
-                                        step_one(s, &cx, &cy);
-                                        if (cx == 0 && cy == 0) {
-                                                hit = 1;
-                                                break;
-                                        }
-                                }
-
-                                /* započítame iba úspešné behy */
-                                int id = idx_of(cfg, x, y);
-                                if (hit) {
-                                        hits[id]++;
-                                        steps_sum[id] += steps;
-                                }
-                        }
-                }
+        /* Monte Carlo replikácie (paralelne, výsledok nezávisí od počtu vlákien) */
+        engine_job_t job;
+        memset(&job, 0, sizeof(job));
+        job.cfg = cfg;
+        job.obstacles = (cfg->world_type == WORLD_OBSTACLES) ? s->obstacles : NULL;
+        job.nbr = &s->nbr;
+        job.dist = s->dist;
+        job.seed = cfg->seed;
+        job.resume = resume ? &resume->state : NULL;
+
+        /* voliteľný histogram časov príchodu pre všetky horizonty <= K */
+        fpt_free(&s->hist);
+        if (cfg->hist_width > 0) {
+                if (fpt_alloc(&s->hist, (uint32_t)total, (uint32_t)grid_idx_of(cfg, 0, 0), cfg->max_steps, cfg->hist_width) == 0)
+                        job.hist = &s->hist;
+                else
+                        printf("[SERVER] out of memory for first-passage histogram\n");
+        }
 
-                printf("[SERVER] replication %u / %u done\n", (unsigned)rep, (unsigned)cfg->replications);
+        /* histogram z checkpointu pokračuje spolu s počtami */
+        if (job.hist && resume && resume->hist.cells == s->hist.cells && resume->hist.buckets == s->hist.buckets) {
+                size_t n = (size_t)s->hist.cells * s->hist.buckets;
+                memcpy(s->hist.hits, resume->hist.hits, n * sizeof(uint32_t));
+                memcpy(s->hist.steps, resume->hist.steps, n * sizeof(uint64_t));
         }
+        job.threads = cfg->threads;
+        job.on_batch = report_progress;
+        job.user = s;
+
+        /* priebežné summary pre klientov počas dlhého behu */
+        if (cfg->snapshot_reps > 0 || cfg->snapshot_ms > 0) {
+                pthread_mutex_lock(&s->live_mtx);
+                memset(&s->live_hdr, 0, sizeof(s->live_hdr));
+                s->live = calloc(total, sizeof(msg_sum_cell_t));
+                if (s->live)
+                        job.on_snapshot = publish_snapshot;
+                pthread_mutex_unlock(&s->live_mtx);
+        }
+
+        /* checkpointy na pozadí */
+        int ckpt = 0;
+        if (cfg->checkpoint_sec > 0 && cfg->checkpoint_file[0] != '\0') {
+                ckpt = checkpoint_start(s) == 0;
+                if (ckpt)
+                        job.on_checkpoint = queue_checkpoint;
+                else
+                        printf("[SERVER] out of memory for checkpoints, running without them\n");
+        }
+
+        int rc;
+        if (cfg->workers > 0 && !resume)
+                rc = shard_run(&job, cfg->workers, hits, steps_sum, reps_used);
+        else
+                rc = engine_run(&job, hits, steps_sum, reps_used);
+
+        if (ckpt)
+                checkpoint_stop(s);
+
+        pthread_mutex_lock(&s->live_mtx);
+        free(s->live);
+        s->live = NULL;
+        pthread_mutex_unlock(&s->live_mtx);
+
+        if (rc != 0) {
+                fpt_free(&s->hist);
+                free(hits);
+                free(steps_sum);
+                free(reps_used);
+                return;
+        }
+
+        if (job.hist)
+                memcpy(s->hist.reps, reps_used, total * sizeof(uint32_t));
 
         /* pripravíme výsledné pole */
         free(s->summary_cells);
-        s->summary_cells = calloc((size_t)(w * h), sizeof(msg_sum_cell_t));
+        s->summary_cells = calloc(total, sizeof(msg_sum_cell_t));
         if (!s->summary_cells) {
                 free(hits);
                 free(steps_sum);
+                free(reps_used);
                 return;
         }
 
         /* pre každé políčko vyrátame avg a probability */
-        for (int y = min_y; y <= max_y; y++) {
-                for (int x = min_x; x <= max_x; x++) {
-                        int id = idx_of(cfg, x, y);
-
-                        if (x == 0 && y == 0) {
-                                s->summary_cells[id].avg_steps = 0.0;
-                                s->summary_cells[id].probability = 1.0;
-                                continue;
-                        }
-
-                        if (is_obstacle(s, x, y)) {
-                                s->summary_cells[id].avg_steps = 0.0;
-                                s->summary_cells[id].probability = 0.0;
-                                continue;
-                        }
-
-                        double p = (double)hits[id] / (double)cfg->replications;
-                        double avg = 0.0;
-                        if (hits[id] > 0)
-                                avg = (double)steps_sum[id] / (double)hits[id];
-
-                        s->summary_cells[id].avg_steps = avg;
-                        s->summary_cells[id].probability = p;
-                }
+        summary_from_counters(cfg, hits, steps_sum, reps_used, s->summary_cells);
+
+        /* surové počty sa ukladajú spolu so summary, aby sa dali spojiť s ďalším behom */
+        free(s->hits);
+        free(s->steps_sum);
+        free(s->reps_used);
+        s->hits = hits;
+        s->steps_sum = steps_sum;
+        s->reps_used = reps_used;
+}
+
+/* presné summary cez DP (rovnaký formát výsledku ako compute_summary) */
+static void compute_exact(server_t *s)
+{
+        free(s->summary_cells);
+        s->summary_cells = calloc(grid_cells(&s->cfg), sizeof(msg_sum_cell_t));
+        if (!s->summary_cells)
+                return;
+
+        const uint64_t *obstacles = (s->cfg.world_type == WORLD_OBSTACLES) ? s->obstacles : NULL;
+        if (exact_run(&s->cfg, obstacles, &s->nbr, s->summary_cells) != 0) {
+                free(s->summary_cells);
+                s->summary_cells = NULL;
         }
+}
 
-        free(hits);
-        free(steps_sum);
+/* prekážky na poslanie: bitová mapa, alebo prázdny prenos pre prázdny svet */
+static uint64_t obstacles_payload(const server_t *s, const void **payload)
+{
+        if (s->cfg.world_type == WORLD_OBSTACLES && s->obstacles) {
+                *payload = s->obstacles;
+                return bitmap_bytes(grid_cells(&s->cfg));
+        }
+        *payload = NULL;
+        return 0;
 }
 
-/* pošle prekážky jednému klientovi */
-static void send_obstacles_to_fd(server_t *s, int fd)
+/* uloží zakódovanú správu pre neskorších klientov a rozošle ju skupine
+   target (OUTQ_ALL, ...; b NULL = len zahodí starú) */
+static void publish_msg(server_t *s, outq_buf_t **slot, outq_buf_t *b, int target)
 {
-        uint32_t size = (uint32_t)(s->cfg.world_width * s->cfg.world_height);
+        pthread_mutex_lock(&s->msg_mtx);
+        outq_buf_t *old = *slot;
+        *slot = b;
+        if (b)
+                outq_send(&s->out, target, b, OUTQ_BULK);
+        pthread_mutex_unlock(&s->msg_mtx);
+        outq_release(old);
+}
 
-        msg_header_t hdr;
-        hdr.type = MSG_OBSTACLES;
-        hdr.size = size;
+/* pošle uloženú správu jednému klientovi (0 = ešte nie je) */
+static int send_msg_to_fd(server_t *s, outq_buf_t *const *slot, int fd)
+{
+        pthread_mutex_lock(&s->msg_mtx);
+        int have = *slot != NULL;
+        if (have)
+                outq_send(&s->out, fd, *slot, OUTQ_BULK);
+        pthread_mutex_unlock(&s->msg_mtx);
+        return have;
+}
 
-        uint8_t *tmp = NULL;
+/* zapíše prekážky alebo summary (flag) do zdieľanej pamäte a oznámi to
+   klientom cez UNIX socket; 0 = nejde, treba ich poslať socketom */
+static int shm_publish(server_t *s, uint32_t flag, const void *data)
+{
+        if (!s->shm_on)
+                return 0;
 
-        /* ak nemáme prekážky, pošleme nulové pole */
-        if (s->cfg.world_type == WORLD_OBSTACLES && s->obstacles) {
-                tmp = s->obstacles;
-        } else {
-                tmp = calloc((size_t)size, 1);
-                if (!tmp)
-                        return;
+        if (s->shm.fd < 0 &&
+            shmres_create(&s->shm, (uint32_t)s->cfg.world_width, (uint32_t)s->cfg.world_height) != 0) {
+                printf("[SERVER] shared memory unavailable, results go over sockets\n");
+                s->shm_on = 0;
+                return 0;
         }
 
-        write_full(fd, &hdr, sizeof(hdr));
-        write_full(fd, tmp, size);
+        msg_shm_ready_t m;
+        memset(&m, 0, sizeof(m));
+        m.size = s->shm.len;
+        if (flag == MSG_SHM_HAS_OBSTACLES)
+                m.generation = shmres_put_obstacles(&s->shm, (const uint64_t *)data);
+        else
+                m.generation = shmres_put_summary(&s->shm, (const msg_sum_cell_t *)data);
+
+        /* neskorší klient dostane len poslednú správu, preto v nej je všetko zverejnené */
+        m.flags = s->shm_flags | flag;
+
+        outq_buf_t *b = outq_frame_fd(MSG_SHM_READY, &m, (uint32_t)sizeof(m), s->shm.fd);
+        if (!b)
+                return 0;
+
+        /* správa a jej príznaky sa menia naraz, pripájajúci sa klient vidí oboje rovnaké */
+        pthread_mutex_lock(&s->msg_mtx);
+        outq_buf_t *old = s->shm_msg;
+        s->shm_msg = b;
+        s->shm_flags = m.flags;
+        outq_send(&s->out, OUTQ_LOCAL, b, OUTQ_BULK);
+        pthread_mutex_unlock(&s->msg_mtx);
+        outq_release(old);
+        return 1;
+}
+
+/* pošle klientovi cez UNIX socket oznámenie o zdieľanej pamäti,
+   vráti, čo v nej už má (MSG_SHM_HAS_*, 0 = nič) */
+static uint32_t send_shm_to_fd(server_t *s, int fd)
+{
+        if (!net_is_local(fd))
+                return 0;
 
-        if (tmp != s->obstacles)
-                free(tmp);
+        pthread_mutex_lock(&s->msg_mtx);
+        uint32_t flags = 0;
+        if (s->shm_msg) {
+                outq_send(&s->out, fd, s->shm_msg, OUTQ_BULK);
+                flags = s->shm_flags;
+        }
+        pthread_mutex_unlock(&s->msg_mtx);
+        return flags;
 }
 
-/* pošle prekážky všetkým klientom */
+/* pošle prekážky jednému klientovi, ak už sú rozoslané; svet sa medzitým
+   môže generovať, neskoršie broadcast_obstacles dostane klient tak či tak */
+static void send_obstacles_to_fd(server_t *s, int fd)
+{
+        send_msg_to_fd(s, &s->obstacles_msg, fd);
+}
+
+/* pošle prekážky všetkým klientom (na tom istom stroji cez zdieľanú pamäť) */
 static void broadcast_obstacles(server_t *s)
 {
-        uint32_t size = (uint32_t)(s->cfg.world_width * s->cfg.world_height);
+        const void *payload;
+        uint64_t size = obstacles_payload(s, &payload);
 
-        if (s->cfg.world_type == WORLD_OBSTACLES && s->obstacles) {
-                broadcast(s, MSG_OBSTACLES, s->obstacles, size);
-        } else {
-                uint8_t *zero = calloc((size_t)size, 1);
-                if (!zero)
-                        return;
-                broadcast(s, MSG_OBSTACLES, zero, size);
-                free(zero);
+        int target = shm_publish(s, MSG_SHM_HAS_OBSTACLES, payload) ? OUTQ_REMOTE : OUTQ_ALL;
+        publish_msg(s, &s->obstacles_msg, outq_frame(MSG_OBSTACLES, 1, payload, size, &s->map), target);
+}
+
+/* pošle histogram časov príchodu jednému klientovi (fd >= 0) alebo všetkým (fd < 0) */
+static void send_hist(server_t *s, int fd)
+{
+        if (fd >= 0) {
+                send_msg_to_fd(s, &s->hist_msg, fd);
+                return;
         }
+
+        if (s->hist.cells == 0)
+                return;
+
+        size_t len = 0;
+        void *buf = fpt_encode(&s->hist, &len);
+        if (!buf)
+                return;
+
+        publish_msg(s, &s->hist_msg, outq_frame(MSG_FPT_HIST, 1, buf, len, NULL), OUTQ_ALL);
+        free(buf);
 }
 
-/* pošle summary jednému klientovi (len ak je hotové) */
-static void send_summary_to_fd(server_t *s, int fd)
+/* pošle summary (a histogram, ak je) jednému klientovi (fd >= 0) alebo všetkým (fd < 0);
+   všetkým na tom istom stroji ide summary cez zdieľanú pamäť */
+static void send_summary(server_t *s, int fd)
 {
-        if (!s->done || !s->summary_cells)
+        if (!s->summary_cells)
                 return;
 
-        uint32_t total = (uint32_t)(s->cfg.world_width * s->cfg.world_height);
-        uint32_t bytes = total * (uint32_t)sizeof(msg_sum_cell_t);
+        if (fd >= 0) {
+                send_msg_to_fd(s, &s->summary_msg, fd);
+        } else {
+                uint64_t bytes = (uint64_t)grid_cells(&s->cfg) * sizeof(msg_sum_cell_t);
+                int target = shm_publish(s, MSG_SHM_HAS_SUMMARY, s->summary_cells) ? OUTQ_REMOTE : OUTQ_ALL;
+                publish_msg(s, &s->summary_msg, outq_frame(MSG_SUMMARY_DATA, 1, s->summary_cells, bytes, &s->map),
+                            target);
+        }
+        send_hist(s, fd);
+}
 
-        msg_header_t hdr;
-        hdr.type = MSG_SUMMARY_DATA;
-        hdr.size = bytes;
+/* nastaví, či je výsledok hotový (čítajú ho aj noví klienti z vlákna reaktora) */
+static void set_done(server_t *s, int done)
+{
+        pthread_mutex_lock(&s->state_mtx);
+        s->done = done;
+        pthread_mutex_unlock(&s->state_mtx);
+}
 
-        write_full(fd, &hdr, sizeof(hdr));
-        write_full(fd, s->summary_cells, bytes);
+/* pošle summary jednému klientovi (len ak je hotové) */
+static void send_summary_to_fd(server_t *s, int fd)
+{
+        pthread_mutex_lock(&s->state_mtx);
+        int done = s->done;
+        pthread_mutex_unlock(&s->state_mtx);
+
+        if (!done)
+                return;
+        send_summary(s, fd);
 }
 
 /* interaktívny režim: posiela kroky po jednom */
 static void run_interactive(server_t *s)
 {
         for (uint32_t rep = 1; rep <= s->cfg.replications; rep++) {
-                int x = 0;
-                int y = 0;
+                uint32_t id = s->nbr.origin;
 
                 for (uint32_t step = 1; step <= s->cfg.max_steps; step++) {
-                        step_one(s, &x, &y);
+                        id = step_one(s, id);
 
                         msg_int_t m;
-                        m.x = x;
-                        m.y = y;
+                        grid_xy_of(&s->cfg, (int)grid_nbr_row(&s->nbr, id), &m.x, &m.y);
                         m.step = step;
                         m.replication = rep;
                         m.total_replications = s->cfg.replications;
 
-                        broadcast(s, MSG_INTERACTIVE_STEP, &m, (uint32_t)sizeof(m));
+                        /* len do frontov, pomalý klient výpočet nezdrží */
+                        outq_message(&s->out, -1, MSG_INTERACTIVE_STEP, OUTQ_STEP, &m, (uint32_t)sizeof(m));
 
                         /* zámerne spomaľujeme, aby to bolo vidno */
                         sleep(1);
 
-                        if (x == 0 && y == 0)
+                        if (id == s->nbr.origin)
                                 break;
                 }
         }
 }
 
+/* načíta checkpoint z input_file a pripraví svet na pokračovanie (0 ok, -1 pri chybe) */
+static int resume_checkpoint(server_t *s, checkpoint_t *ck)
+{
+        char output[256];
+        memcpy(output, s->cfg.output_file, sizeof(output));
+
+        if (load_checkpoint(s->cfg.input_file, ck) != 0)
+                return -1;
+        if (!validate_cfg(&ck->cfg) || ck->cfg.mode == SIM_MODE_EXACT) {
+                checkpoint_free(ck);
+                return -1;
+        }
+
+        /* klient môže výsledok poslať inam než pôvodný beh */
+        s->cfg = ck->cfg;
+        if (output[0] != '\0')
+                memcpy(s->cfg.output_file, output, sizeof(output));
+        s->cfg.output_file[sizeof(s->cfg.output_file) - 1] = '\0';
+
+        /* interaktívna časť prebehla pred checkpointom */
+        s->cfg.mode = SIM_MODE_SUMMARY;
+
+        s->obstacles = ck->obstacles;
+        ck->obstacles = NULL;
+
+        /* dist je len orezávanie, bez neho je výsledok rovnaký */
+        if (s->cfg.world_type == WORLD_OBSTACLES) {
+                if (!s->obstacles || !validate_obstacles(s)) {
+                        free(s->dist);
+                        s->dist = NULL;
+                }
+        } else {
+                compute_dist(s);
+        }
+        return 0;
+}
+
 /* vlákno simulácie: čaká na config, potom spraví load alebo výpočet */
 static void *simulation_thread(void *arg)
 {
         server_t *s = (server_t *)arg;
 
-        /* čakáme, kým príde config */
+        /* čakáme, kým príde config (zobudí nás client_message) */
+        pthread_mutex_lock(&s->state_mtx);
         while (!s->cfg_set)
-                sleep(1);
-
-        /* reset stavu */
+                pthread_cond_wait(&s->state_cond, &s->state_mtx);
+        pthread_mutex_unlock(&s->state_mtx);
+
+        /* reset stavu (polia z namapovaného súboru sa neuvoľňujú) */
+        publish_msg(s, &s->obstacles_msg, NULL, OUTQ_ALL);
+        publish_msg(s, &s->summary_msg, NULL, OUTQ_ALL);
+        publish_msg(s, &s->hist_msg, NULL, OUTQ_ALL);
+
+        /* správa a jej príznaky sa rušia naraz, ako v shm_publish */
+        pthread_mutex_lock(&s->msg_mtx);
+        outq_buf_t *shm_old = s->shm_msg;
+        s->shm_msg = NULL;
+        s->shm_flags = 0;
+        pthread_mutex_unlock(&s->msg_mtx);
+        outq_release(shm_old);
+        shmres_close(&s->shm);
+        if (s->map.base) {
+                s->summary_cells = NULL;
+                s->obstacles = NULL;
+                s->reps_used = NULL;
+                s->hits = NULL;
+                s->steps_sum = NULL;
+                memset(&s->hist, 0, sizeof(s->hist));
+                unmap_simulation(&s->map);
+        }
         free(s->summary_cells);
         s->summary_cells = NULL;
         free(s->obstacles);
         s->obstacles = NULL;
-        s->done = 0;
+        free(s->reps_used);
+        s->reps_used = NULL;
+        free(s->hits);
+        s->hits = NULL;
+        free(s->steps_sum);
+        s->steps_sum = NULL;
+        free(s->dist);
+        s->dist = NULL;
+        fpt_free(&s->hist);
+        grid_nbr_free(&s->nbr);
+        set_done(s, 0);
 
         /* LOAD mód */
         if (s->cfg.start_type == SIM_LOAD) {
                 printf("[SERVER] loading simulation from %s\n", s->cfg.input_file);
 
-                if (load_simulation(s->cfg.input_file, &s->cfg, &s->obstacles, &s->summary_cells) != 0) {
+                if (load_simulation(s->cfg.input_file, &s->cfg, &s->obstacles, &s->summary_cells, &s->reps_used,
+                                    &s->hits, &s->steps_sum, &s->hist, &s->map) != 0) {
                         printf("[SERVER] load failed\n");
-                        s->done = 1;
+                        set_done(s, 1);
                         return NULL;
                 }
 
-                printf("[SERVER] loaded: %dx%d R=%u K=%u type=%d\n",
+                printf("[SERVER] loaded: %dx%d R=%u K=%u type=%d seed=%llu\n",
                         s->cfg.world_width, s->cfg.world_height,
                         (unsigned)s->cfg.replications, (unsigned)s->cfg.max_steps,
-                        (int)s->cfg.world_type);
+                        (int)s->cfg.world_type, (unsigned long long)s->cfg.seed);
 
                 /* pošleme klientom prekážky a summary */
                 broadcast_obstacles(s);
 
-                if (s->summary_cells) {
-                        uint32_t total = (uint32_t)(s->cfg.world_width * s->cfg.world_height);
-                        uint32_t bytes = total * (uint32_t)sizeof(msg_sum_cell_t);
-                        broadcast(s, MSG_SUMMARY_DATA, s->summary_cells, bytes);
-                }
+                send_summary(s, -1);
 
-                s->done = 1;
+                set_done(s, 1);
 
                 /* ak je output, uložíme */
                 if (s->cfg.output_file[0] != '\0' && s->summary_cells) {
-                        save_simulation(s->cfg.output_file, &s->cfg, s->obstacles, s->summary_cells);
+                        save_simulation(s->cfg.output_file, &s->cfg, s->obstacles, s->summary_cells, s->reps_used,
+                                        s->hits, s->steps_sum,
+                                        s->hist.cells ? &s->hist : NULL);
                         printf("[SERVER] results saved to %s\n", s->cfg.output_file);
                 }
 
                 return NULL;
         }
 
-        /* NEW mód */
-        printf("[SERVER] new simulation: %dx%d R=%u K=%u type=%d\n",
-                s->cfg.world_width, s->cfg.world_height,
-                (unsigned)s->cfg.replications, (unsigned)s->cfg.max_steps,
-                (int)s->cfg.world_type);
+        /* RESUME mód - svet, seed aj počty sú v checkpointe */
+        checkpoint_t resume;
+        memset(&resume, 0, sizeof(resume));
+        if (s->cfg.start_type == SIM_RESUME) {
+                printf("[SERVER] resuming from checkpoint %s\n", s->cfg.input_file);
+
+                if (resume_checkpoint(s, &resume) != 0) {
+                        printf("[SERVER] resume failed\n");
+                        set_done(s, 1);
+                        return NULL;
+                }
+
+                printf("[SERVER] resumed: %dx%d R=%u K=%u type=%d seed=%llu at replication %u\n",
+                        s->cfg.world_width, s->cfg.world_height,
+                        (unsigned)s->cfg.replications, (unsigned)s->cfg.max_steps,
+                        (int)s->cfg.world_type, (unsigned long long)s->cfg.seed,
+                        (unsigned)resume.state.reps_done);
+        } else {
+                /* NEW mód - bez zadaného seedu si ho vygenerujeme, aby sa dal beh zopakovať */
+                if (s->cfg.seed == 0)
+                        s->cfg.seed = rng_random_seed();
+                rng_init(&s->rng, s->cfg.seed, 0, 0);
+
+                printf("[SERVER] new simulation: %dx%d R=%u K=%u type=%d seed=%llu\n",
+                        s->cfg.world_width, s->cfg.world_height,
+                        (unsigned)s->cfg.replications, (unsigned)s->cfg.max_steps,
+                        (int)s->cfg.world_type, (unsigned long long)s->cfg.seed);
 
-        ensure_obstacles(s);
+                ensure_obstacles(s);
+        }
         broadcast_obstacles(s);
 
+        /* všetky simulácie ďalej chodia len po indexoch z tabuľky */
+        if (grid_nbr_build(&s->nbr, &s->cfg, s->obstacles) != 0) {
+                printf("[SERVER] out of memory for neighbor table\n");
+                checkpoint_free(&resume);
+                set_done(s, 1);
+                return NULL;
+        }
+
+        /* vzdialenosti čítajú chodci pri každom kroku, preto v poradí tabuľky */
+        if (s->dist && grid_nbr_permute(&s->nbr, s->dist, sizeof(uint32_t)) != 0) {
+                free(s->dist);
+                s->dist = NULL;
+        }
+
         /* interaktívny režim (ak je nastavený) */
         if (s->cfg.mode == SIM_MODE_INTERACTIVE) {
                 printf("[SERVER] interactive start\n");
@@ -618,84 +1055,104 @@ static void *simulation_thread(void *arg)
                 printf("[SERVER] interactive done\n");
         }
 
-        printf("[SERVER] computing summary...\n");
-        compute_summary(s);
+        if (s->cfg.mode == SIM_MODE_EXACT) {
+                printf("[SERVER] computing exact summary (%u sweeps)...\n", (unsigned)s->cfg.max_steps);
+                compute_exact(s);
+        } else {
+                printf("[SERVER] computing summary (kernel=%s%s, %d worker processes)...\n",
+                        walk_kernel_name(), s->cfg.jump ? "+jump" : "", s->cfg.workers);
+                compute_summary(s, resume.state.hits ? &resume : NULL);
+        }
+        checkpoint_free(&resume);
 
         /* uloženie do súboru */
         if (s->summary_cells && s->cfg.output_file[0] != '\0') {
-                save_simulation(s->cfg.output_file, &s->cfg, s->obstacles, s->summary_cells);
+                save_simulation(s->cfg.output_file, &s->cfg, s->obstacles, s->summary_cells, s->reps_used,
+                                        s->hits, s->steps_sum,
+                                        s->hist.cells ? &s->hist : NULL);
                 printf("[SERVER] results saved to %s\n", s->cfg.output_file);
         }
 
         /* pošleme summary klientom */
-        if (s->summary_cells) {
-                uint32_t total = (uint32_t)(s->cfg.world_width * s->cfg.world_height);
-                uint32_t bytes = total * (uint32_t)sizeof(msg_sum_cell_t);
-                broadcast(s, MSG_SUMMARY_DATA, s->summary_cells, bytes);
-        }
+        send_summary(s, -1);
 
-        s->done = 1;
+        set_done(s, 1);
         printf("[SERVER] summary ready\n");
         return NULL;
 }
 
-/* vlákno pre prijímanie klientov */
-static void *accept_thread(void *arg)
+/* nový klient (z UNIX aj TCP socketu): dostane, čo už je hotové
+   (počas výpočtu priebežný stav) */
+static void client_accepted(void *user, int fd)
 {
-        server_t *s = (server_t *)arg;
+        server_t *s = (server_t *)user;
 
-        while (1) {
-                int fd = net_accept(s->listen_fd);
-                if (fd < 0)
-                        continue;
+        printf("[SERVER] client connected\n");
 
-                printf("[SERVER] client connected\n");
+        /* na tom istom stroji číta prekážky a summary zo zdieľanej pamäte */
+        uint32_t shared = send_shm_to_fd(s, fd);
 
-                /* prvý klient musí poslať config */
-                if (!s->cfg_set) {
-                        msg_header_t hdr;
-                        int r = read_full(fd, &hdr, sizeof(hdr));
-
-                        if (r != 1 || hdr.type != MSG_CONFIG || hdr.size != sizeof(config)) {
-                                close(fd);
-                                continue;
-                        }
-
-                        config cfg;
-                        r = read_full(fd, &cfg, sizeof(cfg));
-                        if (r != 1 || !validate_cfg(&cfg)) {
-                                close(fd);
-                                continue;
-                        }
+        if (!(shared & MSG_SHM_HAS_OBSTACLES))
+                send_obstacles_to_fd(s, fd);
+        send_live_to_fd(s, fd);
+        if (shared & MSG_SHM_HAS_SUMMARY)
+                send_hist(s, fd);
+        else
+                send_summary_to_fd(s, fd);
+}
 
-                        s->cfg = cfg;
-                        s->cfg_set = 1;
+/* správa od klienta: prvý platný config spustí simuláciu, potom sa správy
+   ignorujú; klient, ktorý pred tým pošle niečo iné alebo zlý config, sa odpojí */
+static int client_message(void *user, int fd, const msg_header_t *hdr, const void *payload)
+{
+        server_t *s = (server_t *)user;
+        (void)fd;
 
-                        clients_add(&s->clients, fd);
+        /* config zapisuje len toto vlákno, po ňom ho už len číta simulácia */
+        if (s->cfg_set)
+                return 0;
 
-                        /* pošleme aktuálne dáta */
-                        send_obstacles_to_fd(s, fd);
-                        send_summary_to_fd(s, fd);
-                } else {
-                        /* ďalší klienti len dostanú dáta */
-                        clients_add(&s->clients, fd);
-                        send_obstacles_to_fd(s, fd);
-                        send_summary_to_fd(s, fd);
-                }
-        }
+        if (hdr->type != MSG_CONFIG || hdr->size != sizeof(config))
+                return -1;
 
-        return NULL;
+        config cfg;
+        memcpy(&cfg, payload, sizeof(cfg));
+        if (!validate_cfg(&cfg))
+                return -1;
+
+        pthread_mutex_lock(&s->state_mtx);
+        s->cfg = cfg;
+        s->cfg_set = 1;
+        pthread_cond_signal(&s->state_cond);
+        pthread_mutex_unlock(&s->state_mtx);
+        return 0;
 }
 
-/* main: nastaví socket, spustí vlákna a nechá server bežať */
-int main(void)
+/* main: nastaví socket, spustí vlákna a nechá server bežať;
+   voliteľný argument "tcp:host:port" pridá TCP socket pre vzdialených klientov */
+int main(int argc, char **argv)
 {
         setbuf(stdout, NULL);
-        srand((unsigned)time(NULL) ^ (unsigned)getpid());
+
+        /* sendfile nemá MSG_NOSIGNAL, odpojený klient nesmie zhodiť server */
+        signal(SIGPIPE, SIG_IGN);
 
         server_t s;
         memset(&s, 0, sizeof(s));
-        pthread_mutex_init(&s.clients.mtx, NULL);
+        pthread_mutex_init(&s.live_mtx, NULL);
+        pthread_mutex_init(&s.msg_mtx, NULL);
+        pthread_mutex_init(&s.state_mtx, NULL);
+        pthread_cond_init(&s.state_cond, NULL);
+        s.shm.fd = -1;
+
+        /* SIM_SHM=0: klienti na tom istom stroji dostanú výsledky tiež cez socket */
+        const char *shm = getenv("SIM_SHM");
+        s.shm_on = !(shm && strcmp(shm, "0") == 0);
+
+        if (argc > 1 && strncmp(argv[1], "tcp:", 4) != 0) {
+                printf("[SERVER] expected tcp:host:port, got %s\n", argv[1]);
+                return 1;
+        }
 
         /* cesta k socketu podľa PID */
         snprintf(s.sock_path, sizeof(s.sock_path), "/tmp/sim_%d.sock", getpid());
@@ -706,16 +1163,72 @@ int main(void)
 
         printf("[SERVER] listening on %s\n", s.sock_path);
 
+        s.tcp_fd = -1;
+        if (argc > 1) {
+                s.tcp_fd = net_listen(argv[1]);
+                if (s.tcp_fd < 0) {
+                        unlink(s.sock_path);
+                        return 1;
+                }
+
+                char addr[300];
+                if (net_local_addr(s.tcp_fd, addr, sizeof(addr)) == 0)
+                        printf("[SERVER] listening on %s\n", addr);
+        }
+
+        /* pomalí klienti: SIM_LAG_POLICY=coalesce|drop|disconnect, SIM_SEND_QUEUE_KB = limit frontu */
+        outq_lag_t policy = OUTQ_LAG_COALESCE;
+        const char *lag = getenv("SIM_LAG_POLICY");
+        if (lag && strcmp(lag, "drop") == 0) {
+                policy = OUTQ_LAG_DROP;
+        } else if (lag && strcmp(lag, "disconnect") == 0) {
+                policy = OUTQ_LAG_DISCONNECT;
+        } else if (lag && strcmp(lag, "coalesce") != 0) {
+                printf("[SERVER] unknown SIM_LAG_POLICY %s\n", lag);
+                unlink(s.sock_path);
+                return 1;
+        }
+
+        uint64_t limit = 4096 * 1024;
+        const char *kb = getenv("SIM_SEND_QUEUE_KB");
+        if (kb && *kb)
+                limit = strtoull(kb, NULL, 10) * 1024;
+
+        outq_handler_t handler = { client_accepted, client_message, &s };
+        if (outq_init(&s.out, &handler, policy, limit) != 0 ||
+            outq_listen(&s.out, s.listen_fd) != 0 ||
+            (s.tcp_fd >= 0 && outq_listen(&s.out, s.tcp_fd) != 0)) {
+                unlink(s.sock_path);
+                return 1;
+        }
+
+        /* sockety počúvajú: klient, ktorý server spustil, sa môže hneď pripojiť
+           (SIM_READY_FD = zápisový koniec jeho rúry) */
+        const char *ready = getenv("SIM_READY_FD");
+        if (ready && *ready) {
+                int ready_fd = atoi(ready);
+                ssize_t r = write(ready_fd, "1", 1);
+                (void)r;
+                close(ready_fd);
+        }
+
+        /* každý klient je jeden fd, predvolený limit by tisíce pozorovateľov nepustil */
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+                rl.rlim_cur = rl.rlim_max;
+                setrlimit(RLIMIT_NOFILE, &rl);
+        }
+
         pthread_create(&s.sim_tid, NULL, simulation_thread, &s);
-        pthread_create(&s.accept_tid, NULL, accept_thread, &s);
+        outq_start(&s.out);
 
         /* čakáme, kým simulácia skončí */
         pthread_join(s.sim_tid, NULL);
 
         printf("[SERVER] simulation finished, server stays up for connects\n");
 
-        /* server ostáva bežať, aby sa dalo pripojiť aj neskôr */
-        while (1)
-                sleep(1);
+        /* server ostáva bežať, aby sa dalo pripojiť aj neskôr; vlákno reaktora neskončí */
+        pthread_join(s.out.tid, NULL);
+        return 0;
 }
 
@@ -0,0 +1,477 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "engine.h"
+#include "grid.h"
+#include "jump.h"
+#include "pool.h"
+#include "walk.h"
+
+/* najviac políčok v jednom bloku práce */
+#define ENGINE_CHUNK_CELLS 64
+
+/* najmenej políčok v bloku, keď sa malý svet delí jemnejšie */
+#define ENGINE_CHUNK_MIN_CELLS 8
+
+/* minimálny počet blokov na vlákno v jednej dávke (kvôli kradnutiu práce) */
+#define ENGINE_TASKS_PER_THREAD 8
+
+/* adaptívny režim: políčko sa nevyradí skôr, než má toľkoto replikácií */
+#define ENGINE_ADAPTIVE_MIN_REPS 32
+
+/* adaptívny režim: dávka medzi dvoma kontrolami intervalov; pevná, lebo vyraďuje
+   sa len na jej hraniciach a výsledok nesmie závisieť od počtu vlákien */
+#define ENGINE_ADAPTIVE_BATCH 16
+
+/* makro-kroky sa oplatia až vtedy, keď priemerný skok prekoná vektorové jadro */
+#define ENGINE_JUMP_MIN_GAIN 16.0
+
+/* kvantil N(0,1) pre 95 % interval */
+#define ENGINE_Z95 1.959963984540054
+
+/* Welfordov priebežný priemer a rozptyl jedného políčka */
+typedef struct {
+        double hit_mean;        /* priemer indikátora zásahu */
+        double hit_m2;
+        double steps_mean;      /* priemer krokov medzi zásahmi */
+        double steps_m2;
+} engine_welford_t;
+
+/* zdieľaný stav jednej dávky */
+typedef struct {
+        const engine_job_t *job;
+        size_t total;           /* počet políčok (indexy samotné sú 32-bitové) */
+        size_t chunk_cells;     /* políčka jedného bloku (najviac ENGINE_CHUNK_CELLS) */
+        uint64_t nchunks;
+        uint32_t rep_base;      /* prvá replikácia dávky (od cfg->first_rep) */
+        uint64_t *hits;         /* total políčok, spoločné pre všetky vlákna (atomicky) */
+        uint64_t *steps_sum;
+        uint64_t *steps_sq;     /* súčet štvorcov krokov (len adaptívny režim) */
+        const uint8_t *retired; /* 1 = políčko už má dosť presný odhad */
+        const uint64_t *obstacles;  /* prekážky v poradí tabuľky (NULL = žiadne) */
+        walk_env_t walk;
+} engine_ctx_t;
+
+/* políčko, z ktorého sa nedá trafiť [0,0] ani teoreticky (alebo sa nesimuluje vôbec) */
+static int engine_skip_cell(const engine_ctx_t *c, int id)
+{
+        const engine_job_t *job = c->job;
+
+        if (id == (int)job->nbr->origin)
+                return 1;
+        if (c->obstacles && bitmap_get(c->obstacles, (size_t)id))
+                return 1;
+        if (job->dist && job->dist[id] > job->cfg->max_steps)
+                return 1;
+        return 0;
+}
+
+/* jeden blok: jedna replikácia pre chunk_cells políčok */
+static void engine_task(void *arg, int worker, uint64_t task)
+{
+        engine_ctx_t *c = (engine_ctx_t *)arg;
+        (void)worker;
+
+        uint32_t rep = c->rep_base + (uint32_t)(task / c->nchunks);
+        uint64_t chunk = task % c->nchunks;
+
+        size_t first = (size_t)chunk * c->chunk_cells;
+        size_t last = first + c->chunk_cells;
+        if (last > c->total)
+                last = c->total;
+
+        /* chodci tohto bloku: všetky voľné políčka okrem cieľa a beznádejných */
+        int cells[ENGINE_CHUNK_CELLS];
+        uint32_t hit_step[ENGINE_CHUNK_CELLS];
+        int n = 0;
+
+        for (size_t id = first; id < last; id++) {
+                if (engine_skip_cell(c, (int)id))
+                        continue;
+                if (c->retired && c->retired[id])
+                        continue;
+                cells[n++] = (int)id;
+        }
+
+        if (n == 0)
+                return;
+
+        walk_batch(&c->walk, rep, cells, n, hit_step);
+
+        fpt_hist_t *hist = c->job->hist;
+
+        /* započítame iba úspešné behy; polia sú spoločné, iné replikácie toho istého
+           bloku môžu bežať súčasne; zásahov je málo oproti krokom, takže atomické
+           sčítanie nevadí a pamäť nerastie s počtom vlákien */
+        for (int i = 0; i < n; i++) {
+                if (hit_step[i]) {
+                        size_t id = (size_t)cells[i];
+                        __atomic_fetch_add(&c->hits[id], 1u, __ATOMIC_RELAXED);
+                        __atomic_fetch_add(&c->steps_sum[id], (uint64_t)hit_step[i], __ATOMIC_RELAXED);
+                        if (c->steps_sq)
+                                __atomic_fetch_add(&c->steps_sq[id], (uint64_t)hit_step[i] * hit_step[i],
+                                                   __ATOMIC_RELAXED);
+
+                        /* histogram je po riadkoch, prepočet indexu stojí len raz na zásah */
+                        if (hist) {
+                                size_t row = grid_nbr_row(c->job->nbr, (uint32_t)cells[i]);
+                                size_t b = row * hist->buckets + fpt_bucket(hist, hit_step[i]);
+                                __atomic_fetch_add(&hist->hits[b], 1u, __ATOMIC_RELAXED);
+                                __atomic_fetch_add(&hist->steps[b], (uint64_t)hit_step[i], __ATOMIC_RELAXED);
+                        }
+                }
+        }
+}
+
+/* Chanovo spojenie Welfordovho stavu (n_a, mean, m2) so skupinou (n_b, sum, sumsq) */
+static void welford_merge(double n_a, double *mean, double *m2, double n_b, double sum, double sumsq)
+{
+        if (n_b <= 0.0)
+                return;
+
+        double mean_b = sum / n_b;
+        double m2_b = sumsq - sum * mean_b;
+        if (m2_b < 0.0)
+                m2_b = 0.0;
+
+        double n = n_a + n_b;
+        double delta = mean_b - *mean;
+        *mean += delta * n_b / n;
+        *m2 += m2_b + delta * delta * n_a * n_b / n;
+}
+
+/* polovičná šírka 95 % intervalu (Wilsonova korekcia, aby p = 0 alebo 1 nemalo nulovú šírku) */
+static double ci_half_width(double var, double n)
+{
+        double z = ENGINE_Z95;
+        double z2n = z * z / n;
+        return z * sqrt(var / n + z2n / (4.0 * n)) / (1.0 + z2n);
+}
+
+/* po dávke: aktualizuje Welfordove odhady a vyradí políčka s dosť úzkym intervalom */
+static uint64_t engine_adapt(const config *cfg, engine_welford_t *wf, uint8_t *retired, uint32_t *reps_used,
+                             const uint64_t *hits, const uint64_t *b_hits, const uint64_t *b_steps,
+                             const uint64_t *b_sq, uint32_t batch_reps, size_t total)
+{
+        uint64_t active = 0;
+
+        for (size_t i = 0; i < total; i++) {
+                if (retired[i])
+                        continue;
+
+                engine_welford_t *w = &wf[i];
+                double n_a = (double)reps_used[i];
+                double h_b = (double)b_hits[i];
+                double h_a = (double)(hits[i] - b_hits[i]);
+
+                /* zásah je 0/1, takže súčet štvorcov = počet zásahov */
+                welford_merge(n_a, &w->hit_mean, &w->hit_m2, (double)batch_reps, h_b, h_b);
+                welford_merge(h_a, &w->steps_mean, &w->steps_m2, h_b, (double)b_steps[i], (double)b_sq[i]);
+                reps_used[i] += batch_reps;
+
+                double n = (double)reps_used[i];
+                if (reps_used[i] >= ENGINE_ADAPTIVE_MIN_REPS) {
+                        double hit_var = (n > 1.0) ? w->hit_m2 / (n - 1.0) : 0.0;
+                        int ok = ci_half_width(hit_var, n) <= cfg->ci_tolerance;
+
+                        /* priemer krokov má relatívnu toleranciu (stačí, ak niekedy trafil) */
+                        double hn = (double)hits[i];
+                        if (ok && hn > 1.0) {
+                                double steps_var = w->steps_m2 / (hn - 1.0);
+                                ok = ENGINE_Z95 * sqrt(steps_var / hn) <= cfg->ci_tolerance * w->steps_mean;
+                        }
+
+                        if (ok) {
+                                retired[i] = 1;
+                                continue;
+                        }
+                }
+                active++;
+        }
+
+        return active;
+}
+
+/* postaví tabuľky skokov a voľné okolie; NULL, ak sa skoky v tomto svete neoplatia
+   (husté prekážky nechajú len krátke skoky a vektorové krokovanie je rýchlejšie) */
+static uint8_t *engine_jump_setup(const engine_ctx_t *c, jump_table_t *jt)
+{
+        const engine_job_t *job = c->job;
+        const config *cfg = job->cfg;
+        size_t total = grid_cells(cfg);
+
+        uint8_t *clear = malloc(total);
+        if (!clear)
+                return NULL;
+        if (grid_clearance(cfg, job->obstacles, clear) != 0 ||
+            grid_nbr_permute(job->nbr, clear, 1) != 0) {
+                free(clear);
+                return NULL;
+        }
+        if (jump_build(jt, &cfg->probs) != 0) {
+                free(clear);
+                return NULL;
+        }
+
+        /* priemerná dĺžka skoku zo štartových políčok */
+        double gain = 0.0;
+        uint64_t cells = 0;
+        for (size_t i = 0; i < total; i++) {
+                if (engine_skip_cell(c, (int)i))
+                        continue;
+                int l = jump_level_for(jt, clear[i], cfg->max_steps);
+                gain += (l >= 0) ? (double)jt->lv[l].m : 1.0;
+                cells++;
+        }
+
+        if (cells == 0 || gain < ENGINE_JUMP_MIN_GAIN * (double)cells) {
+                jump_free(jt);
+                free(clear);
+                return NULL;
+        }
+        return clear;
+}
+
+/* stav z checkpointu (po riadkoch) do polí výpočtu v poradí tabuľky */
+static int engine_restore(const engine_ctx_t *c, const engine_state_t *st, uint64_t *hits, uint64_t *steps_sum,
+                          uint32_t *reps_used, engine_welford_t *wf, uint8_t *retired)
+{
+        const grid_nbr_t *nbr = c->job->nbr;
+        size_t total = c->total;
+
+        memcpy(hits, st->hits, total * sizeof(uint64_t));
+        memcpy(steps_sum, st->steps_sum, total * sizeof(uint64_t));
+        memcpy(reps_used, st->reps_used, total * sizeof(uint32_t));
+        if (grid_nbr_permute(nbr, hits, sizeof(uint64_t)) != 0 ||
+            grid_nbr_permute(nbr, steps_sum, sizeof(uint64_t)) != 0 ||
+            grid_nbr_permute(nbr, reps_used, sizeof(uint32_t)) != 0)
+                return -1;
+
+        /* adaptívny režim potrebuje aj Welfordove odhady a vyradené políčka */
+        if (wf) {
+                if (!st->welford || !st->retired)
+                        return -1;
+                memcpy(wf, st->welford, total * sizeof(engine_welford_t));
+                memcpy(retired, st->retired, total);
+                if (grid_nbr_permute(nbr, wf, sizeof(engine_welford_t)) != 0 ||
+                    grid_nbr_permute(nbr, retired, 1) != 0)
+                        return -1;
+        }
+        return 0;
+}
+
+/* milisekundy od štartu výpočtu */
+static uint64_t elapsed_ms(const struct timespec *start)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)(now.tv_sec - start->tv_sec) * 1000u +
+               (uint64_t)((now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+int engine_run(const engine_job_t *job, uint64_t *hits, uint64_t *steps_sum, uint32_t *reps_used)
+{
+        const config *cfg = job->cfg;
+        size_t total = grid_cells(cfg);
+        int adaptive = cfg->adaptive != 0;
+
+        pool_t *pool = pool_create(job->threads);
+        if (!pool)
+                return -1;
+
+        int threads = pool_threads(pool);
+
+        engine_ctx_t ctx;
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.job = job;
+        ctx.total = total;
+        ctx.chunk_cells = ENGINE_CHUNK_CELLS;
+
+        /* adaptívna dávka je pevná, malý svet sa preto delí na menšie bloky,
+           aby sa vlákna mali o čo deliť */
+        uint64_t want = (uint64_t)threads * ENGINE_TASKS_PER_THREAD;
+        if (adaptive) {
+                uint64_t chunks = (want + ENGINE_ADAPTIVE_BATCH - 1) / ENGINE_ADAPTIVE_BATCH;
+                uint64_t cells = ((uint64_t)total + chunks - 1) / chunks;
+                if (cells < ENGINE_CHUNK_MIN_CELLS)
+                        cells = ENGINE_CHUNK_MIN_CELLS;
+                if (cells < ctx.chunk_cells)
+                        ctx.chunk_cells = (size_t)cells;
+        }
+        ctx.nchunks = ((uint64_t)total + ctx.chunk_cells - 1) / ctx.chunk_cells;
+
+        /* neadaptívny režim sčítava rovno do výsledku, adaptívny do polí dávky */
+        ctx.hits = hits;
+        ctx.steps_sum = steps_sum;
+
+        /* prekážky v poradí tabuľky; bez prepočtu stačí mapa od volajúceho */
+        uint64_t *obstacles = NULL;
+        ctx.obstacles = job->obstacles;
+        if (job->obstacles && job->nbr->to_id) {
+                obstacles = grid_nbr_bitmap(job->nbr, job->obstacles);
+                ctx.obstacles = obstacles;
+        }
+
+        /* adaptívny režim: odhady po dávkach a príznak vyradenia */
+        uint64_t *b_hits = NULL, *b_steps = NULL, *b_sq = NULL;
+        engine_welford_t *wf = NULL;
+        uint8_t *retired = NULL;
+        if (adaptive) {
+                b_hits = calloc(total, sizeof(uint64_t));
+                b_steps = calloc(total, sizeof(uint64_t));
+                b_sq = calloc(total, sizeof(uint64_t));
+                wf = calloc(total, sizeof(*wf));
+                retired = calloc(total, 1);
+                ctx.hits = b_hits;
+                ctx.steps_sum = b_steps;
+                ctx.steps_sq = b_sq;
+        }
+
+        /* pri pokračovaní sa stav z checkpointu prevedie do poradia tabuľky */
+        if ((job->obstacles && !ctx.obstacles) ||
+            (adaptive && (!b_hits || !b_steps || !b_sq || !wf || !retired)) ||
+            (job->resume && engine_restore(&ctx, job->resume, hits, steps_sum, reps_used, wf, retired) != 0)) {
+                free(b_hits);
+                free(b_steps);
+                free(b_sq);
+                free(wf);
+                free(retired);
+                free(obstacles);
+                pool_destroy(pool);
+                return -1;
+        }
+
+        ctx.walk.cfg = cfg;
+        ctx.walk.nbr = job->nbr;
+        ctx.walk.dist = job->dist;
+        ctx.walk.seed = job->seed;
+
+        /* makro-kroky: alias tabuľky pre probs a voľné okolie políčok */
+        jump_table_t jt;
+        uint8_t *clear = cfg->jump ? engine_jump_setup(&ctx, &jt) : NULL;
+        if (clear) {
+                ctx.walk.jump = &jt;
+                ctx.walk.clear = clear;
+        }
+        ctx.retired = retired;
+
+        /* políčka, ktoré sa vôbec nesimulujú, sú vyradené od začiatku */
+        uint64_t active = 0;
+        for (size_t i = 0; i < total; i++) {
+                int skip = engine_skip_cell(&ctx, (int)i);
+                if (retired && skip)
+                        retired[i] = 1;
+                if (retired ? !retired[i] : !skip)
+                        active++;
+        }
+
+        /* dávka musí mať dosť blokov, aby sa vlákna mali o čo deliť
+           (mimo adaptívneho režimu na nej výsledok nezávisí) */
+        uint32_t batch = (uint32_t)((want + ctx.nchunks - 1) / ctx.nchunks);
+        if (batch == 0)
+                batch = 1;
+        if (adaptive)
+                batch = ENGINE_ADAPTIVE_BATCH;
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        uint32_t rep = job->resume ? job->resume->reps_done : 0;
+
+        /* posledný priebežný stav a checkpoint */
+        uint32_t snap_rep = rep;
+        uint64_t snap_ms = 0;
+        uint64_t ckpt_ms = 0;
+
+        while (rep < cfg->replications && active > 0) {
+                uint32_t n = cfg->replications - rep;
+                if (n > batch)
+                        n = batch;
+
+                ctx.rep_base = cfg->first_rep + rep;
+                if (adaptive) {
+                        memset(b_hits, 0, total * sizeof(uint64_t));
+                        memset(b_steps, 0, total * sizeof(uint64_t));
+                        memset(b_sq, 0, total * sizeof(uint64_t));
+                }
+                pool_run(pool, (uint64_t)n * ctx.nchunks, engine_task, &ctx);
+                rep += n;
+
+                if (adaptive) {
+                        for (size_t i = 0; i < total; i++) {
+                                hits[i] += b_hits[i];
+                                steps_sum[i] += b_steps[i];
+                        }
+                        active = engine_adapt(cfg, wf, retired, reps_used, hits, b_hits, b_steps, b_sq, n, total);
+                }
+
+                if (job->on_batch)
+                        job->on_batch(job->user, rep, active);
+
+                /* po uplynutí času vrátime to, čo máme */
+                uint64_t now_ms = elapsed_ms(&start);
+                if (cfg->deadline_sec > 0 && now_ms >= (uint64_t)cfg->deadline_sec * 1000u)
+                        break;
+
+                /* priebežný stav; po poslednej dávke ho nahradí výsledok */
+                int due = (cfg->snapshot_reps > 0 && rep - snap_rep >= cfg->snapshot_reps) ||
+                          (cfg->snapshot_ms > 0 && now_ms - snap_ms >= cfg->snapshot_ms);
+                if (job->on_snapshot && due && rep < cfg->replications && active > 0) {
+                        if (!adaptive) {
+                                for (size_t i = 0; i < total; i++)
+                                        reps_used[i] = rep;
+                        }
+                        job->on_snapshot(job->user, hits, steps_sum, reps_used, rep, active);
+                        snap_rep = rep;
+                        snap_ms = elapsed_ms(&start);
+                }
+
+                /* checkpoint: kópiu stavu si volajúci zapíše na pozadí */
+                if (job->on_checkpoint && cfg->checkpoint_sec > 0 && rep < cfg->replications && active > 0 &&
+                    now_ms - ckpt_ms >= (uint64_t)cfg->checkpoint_sec * 1000u) {
+                        if (!adaptive) {
+                                for (size_t i = 0; i < total; i++)
+                                        reps_used[i] = rep;
+                        }
+
+                        engine_state_t st;
+                        st.reps_done = rep;
+                        st.hits = hits;
+                        st.steps_sum = steps_sum;
+                        st.reps_used = reps_used;
+                        st.welford = (double *)(void *)wf;
+                        st.retired = retired;
+                        job->on_checkpoint(job->user, &st);
+                        ckpt_ms = elapsed_ms(&start);
+                }
+        }
+
+        pool_destroy(pool);
+
+        if (!adaptive) {
+                for (size_t i = 0; i < total; i++)
+                        reps_used[i] = rep;
+        }
+
+        free(b_hits);
+        free(b_steps);
+        free(b_sq);
+        free(wf);
+        free(retired);
+        free(obstacles);
+        if (clear) {
+                jump_free(&jt);
+                free(clear);
+        }
+
+        /* výsledky sa počítali v poradí tabuľky, volajúci ich chce po riadkoch */
+        if (grid_nbr_unpermute(job->nbr, hits, sizeof(uint64_t)) != 0 ||
+            grid_nbr_unpermute(job->nbr, steps_sum, sizeof(uint64_t)) != 0 ||
+            grid_nbr_unpermute(job->nbr, reps_used, sizeof(uint32_t)) != 0)
+                return -1;
+        return 0;
+}
@@ -0,0 +1,179 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "exact.h"
+#include "grid.h"
+#include "pool.h"
+
+/* rozmer dlaždice jedného prechodu (4 polia double sa zmestia do L2) */
+#define EXACT_TILE_ROWS 32
+#define EXACT_TILE_COLS 256
+
+/* pri inom poradí ako po riadkoch ide prechod po úsekoch rovnakej veľkosti */
+#define EXACT_SPAN_CELLS (EXACT_TILE_ROWS * EXACT_TILE_COLS)
+
+/* stav jedného prechodu: čítame z *_prev, zapisujeme do *_next */
+typedef struct {
+        const config *cfg;
+        const uint64_t *obstacles;  /* v poradí tabuľky */
+        const uint32_t *next;   /* tabuľka susedov */
+        int w;
+        int h;
+        int origin;
+        int tiles_x;
+
+        const double *p_prev;   /* P(zásah do k-1 krokov) */
+        const double *s_prev;   /* E[kroky * 1{zásah do k-1 krokov}] */
+        double *p_next;
+        double *s_next;
+} exact_ctx_t;
+
+/* jeden krok DP pre políčko id (index tabuľky) */
+static inline void exact_cell(const exact_ctx_t *c, size_t id, double pu, double pd, double pl, double pr)
+{
+        if (c->obstacles && bitmap_get(c->obstacles, id)) {
+                c->p_next[id] = 0.0;
+                c->s_next[id] = 0.0;
+                return;
+        }
+        if (id == (size_t)c->origin) {
+                c->p_next[id] = 1.0;
+                c->s_next[id] = 0.0;
+                return;
+        }
+
+        /* prekážky sú už v tabuľke (blokovaný pohyb = ostane) */
+        const uint32_t *nb = &c->next[4 * id];
+        uint32_t u = nb[GRID_UP];
+        uint32_t d = nb[GRID_DOWN];
+        uint32_t l = nb[GRID_LEFT];
+        uint32_t r = nb[GRID_RIGHT];
+
+        const double *P = c->p_prev;
+        const double *S = c->s_prev;
+
+        /* T = 1 + T(sused) -> E[T 1{T<=k}] = sum p * (P_{k-1} + S_{k-1}) */
+        c->p_next[id] = pu * P[u] + pd * P[d] + pl * P[l] + pr * P[r];
+        c->s_next[id] = pu * (P[u] + S[u]) + pd * (P[d] + S[d]) +
+                        pl * (P[l] + S[l]) + pr * (P[r] + S[r]);
+}
+
+/* jeden prechod stencilu cez jednu dlaždicu (poradie po riadkoch) */
+static void exact_tile(void *arg, int worker, uint64_t task)
+{
+        exact_ctx_t *c = (exact_ctx_t *)arg;
+        (void)worker;
+
+        int w = c->w;
+        int h = c->h;
+        int ty = (int)(task / (uint64_t)c->tiles_x);
+        int tx = (int)(task % (uint64_t)c->tiles_x);
+
+        int row_end = (ty + 1) * EXACT_TILE_ROWS;
+        int col_end = (tx + 1) * EXACT_TILE_COLS;
+        if (row_end > h)
+                row_end = h;
+        if (col_end > w)
+                col_end = w;
+
+        const probabilities_t *p = &c->cfg->probs;
+
+        for (int iy = ty * EXACT_TILE_ROWS; iy < row_end; iy++)
+                for (int ix = tx * EXACT_TILE_COLS; ix < col_end; ix++)
+                        exact_cell(c, (size_t)iy * (size_t)w + (size_t)ix, p->p_up, p->p_down, p->p_left, p->p_right);
+}
+
+/* jeden prechod cez súvislý úsek indexov (dlaždice a Z-poradie už susedov držia pokope) */
+static void exact_span(void *arg, int worker, uint64_t task)
+{
+        exact_ctx_t *c = (exact_ctx_t *)arg;
+        (void)worker;
+
+        size_t total = (size_t)c->w * (size_t)c->h;
+        size_t first = (size_t)task * EXACT_SPAN_CELLS;
+        size_t last = first + EXACT_SPAN_CELLS;
+        if (last > total)
+                last = total;
+
+        const probabilities_t *p = &c->cfg->probs;
+
+        for (size_t id = first; id < last; id++)
+                exact_cell(c, id, p->p_up, p->p_down, p->p_left, p->p_right);
+}
+
+int exact_run(const config *cfg, const uint64_t *obstacles, const grid_nbr_t *nbr, msg_sum_cell_t *summary)
+{
+        int w = cfg->world_width;
+        int h = cfg->world_height;
+        size_t total = (size_t)w * (size_t)h;
+
+        double *p_a = calloc(total, sizeof(double));
+        double *s_a = calloc(total, sizeof(double));
+        double *p_b = calloc(total, sizeof(double));
+        double *s_b = calloc(total, sizeof(double));
+        pool_t *pool = pool_create(cfg->threads);
+
+        /* prekážky v poradí tabuľky */
+        uint64_t *obst = (obstacles && nbr->to_id) ? grid_nbr_bitmap(nbr, obstacles) : NULL;
+
+        if (!p_a || !s_a || !p_b || !s_b || !pool || (obstacles && nbr->to_id && !obst)) {
+                free(obst);
+                free(p_a);
+                free(s_a);
+                free(p_b);
+                free(s_b);
+                pool_destroy(pool);
+                return -1;
+        }
+
+        exact_ctx_t ctx;
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.cfg = cfg;
+        ctx.obstacles = obst ? obst : obstacles;
+        ctx.next = nbr->next;
+        ctx.w = w;
+        ctx.h = h;
+        ctx.origin = (int)nbr->origin;
+        ctx.tiles_x = (w + EXACT_TILE_COLS - 1) / EXACT_TILE_COLS;
+        int tiles_y = (h + EXACT_TILE_ROWS - 1) / EXACT_TILE_ROWS;
+
+        /* po riadkoch treba 2D dlaždice, inak stačia súvislé úseky */
+        pool_task_fn sweep = exact_tile;
+        uint64_t tasks = (uint64_t)ctx.tiles_x * (uint64_t)tiles_y;
+        if (nbr->to_id) {
+                sweep = exact_span;
+                tasks = ((uint64_t)total + EXACT_SPAN_CELLS - 1) / EXACT_SPAN_CELLS;
+        }
+
+        /* k = 0: trafené je len samotné [0,0] */
+        p_a[ctx.origin] = 1.0;
+
+        for (uint32_t k = 1; k <= cfg->max_steps; k++) {
+                ctx.p_prev = p_a;
+                ctx.s_prev = s_a;
+                ctx.p_next = p_b;
+                ctx.s_next = s_b;
+                pool_run(pool, tasks, sweep, &ctx);
+
+                /* výmena bufferov */
+                double *tp = p_a; p_a = p_b; p_b = tp;
+                double *ts = s_a; s_a = s_b; s_b = ts;
+        }
+
+        pool_destroy(pool);
+
+        /* summary je po riadkoch */
+        for (size_t i = 0; i < total; i++) {
+                double p = p_a[i];
+                msg_sum_cell_t *out = &summary[grid_nbr_row(nbr, (uint32_t)i)];
+                out->probability = p;
+                out->avg_steps = (p > 0.0) ? s_a[i] / p : 0.0;
+        }
+
+        free(obst);
+        free(p_a);
+        free(s_a);
+        free(p_b);
+        free(s_b);
+        return 0;
+}
@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "fpt.h"
+
+int fpt_alloc(fpt_hist_t *h, uint32_t cells, uint32_t origin, uint32_t max_steps, uint32_t width)
+{
+        memset(h, 0, sizeof(*h));
+        if (width == 0 || max_steps == 0)
+                return -1;
+
+        h->width = width;
+        h->buckets = (max_steps + width - 1) / width;
+        h->cells = cells;
+        h->max_steps = max_steps;
+        h->origin = origin;
+
+        size_t n = (size_t)cells * h->buckets;
+        h->reps = calloc((size_t)cells, sizeof(uint32_t));
+        h->hits = calloc(n, sizeof(uint32_t));
+        h->steps = calloc(n, sizeof(uint64_t));
+        if (!h->reps || !h->hits || !h->steps) {
+                fpt_free(h);
+                return -1;
+        }
+        return 0;
+}
+
+void fpt_free(fpt_hist_t *h)
+{
+        free(h->reps);
+        free(h->hits);
+        free(h->steps);
+        memset(h, 0, sizeof(*h));
+}
+
+uint32_t fpt_horizon(const fpt_hist_t *h, uint32_t k)
+{
+        if (k >= h->max_steps)
+                return h->max_steps;
+        if (k < h->width)
+                return h->width < h->max_steps ? h->width : h->max_steps;
+        return k - k % h->width;
+}
+
+void fpt_summary(const fpt_hist_t *h, uint32_t k, msg_sum_cell_t *out)
+{
+        k = fpt_horizon(h, k);
+
+        /* koše, ktoré celé ležia do horizontu */
+        uint32_t nb = (k == h->max_steps) ? h->buckets : k / h->width;
+
+        for (uint32_t i = 0; i < h->cells; i++) {
+                if (i == h->origin) {
+                        out[i].avg_steps = 0.0;
+                        out[i].probability = 1.0;
+                        continue;
+                }
+
+                const uint32_t *hc = &h->hits[(size_t)i * h->buckets];
+                const uint64_t *sc = &h->steps[(size_t)i * h->buckets];
+                uint64_t hits = 0, steps = 0;
+                for (uint32_t b = 0; b < nb; b++) {
+                        hits += hc[b];
+                        steps += sc[b];
+                }
+
+                out[i].probability = h->reps[i] ? (double)hits / (double)h->reps[i] : 0.0;
+                out[i].avg_steps = hits ? (double)steps / (double)hits : 0.0;
+        }
+}
+
+/* poradie v správe: hlavička, steps (kvôli zarovnaniu), hits, reps */
+void *fpt_encode(const fpt_hist_t *h, size_t *len)
+{
+        size_t n = (size_t)h->cells * h->buckets;
+        size_t bytes = sizeof(msg_fpt_hdr_t) + n * sizeof(uint64_t) +
+                       n * sizeof(uint32_t) + (size_t)h->cells * sizeof(uint32_t);
+
+        uint8_t *buf = malloc(bytes);
+        if (!buf)
+                return NULL;
+
+        msg_fpt_hdr_t hdr;
+        hdr.width = h->width;
+        hdr.buckets = h->buckets;
+        hdr.cells = h->cells;
+        hdr.max_steps = h->max_steps;
+        hdr.origin = h->origin;
+        hdr.reserved = 0;
+
+        uint8_t *p = buf;
+        memcpy(p, &hdr, sizeof(hdr));
+        p += sizeof(hdr);
+        memcpy(p, h->steps, n * sizeof(uint64_t));
+        p += n * sizeof(uint64_t);
+        memcpy(p, h->hits, n * sizeof(uint32_t));
+        p += n * sizeof(uint32_t);
+        memcpy(p, h->reps, (size_t)h->cells * sizeof(uint32_t));
+
+        *len = bytes;
+        return buf;
+}
+
+int fpt_decode(fpt_hist_t *h, const void *buf, size_t len)
+{
+        msg_fpt_hdr_t hdr;
+        if (len < sizeof(hdr))
+                return -1;
+        memcpy(&hdr, buf, sizeof(hdr));
+
+        if (hdr.width == 0 || hdr.max_steps == 0 ||
+            hdr.buckets != (hdr.max_steps + hdr.width - 1) / hdr.width ||
+            (hdr.cells > 0 && hdr.origin >= hdr.cells))
+                return -1;
+
+        size_t n = (size_t)hdr.cells * hdr.buckets;
+        size_t bytes = sizeof(hdr) + n * sizeof(uint64_t) +
+                       n * sizeof(uint32_t) + (size_t)hdr.cells * sizeof(uint32_t);
+        if (len != bytes)
+                return -1;
+
+        if (fpt_alloc(h, hdr.cells, hdr.origin, hdr.max_steps, hdr.width) != 0)
+                return -1;
+
+        const uint8_t *p = (const uint8_t *)buf + sizeof(hdr);
+        memcpy(h->steps, p, n * sizeof(uint64_t));
+        p += n * sizeof(uint64_t);
+        memcpy(h->hits, p, n * sizeof(uint32_t));
+        p += n * sizeof(uint32_t);
+        memcpy(h->reps, p, (size_t)hdr.cells * sizeof(uint32_t));
+        return 0;
+}
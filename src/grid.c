@@ -0,0 +1,308 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "grid.h"
+
+/* strana dlaždice pri GRID_LAYOUT_TILED (64 políčok = jeden blok práce enginu) */
+#define GRID_TILE 8
+
+/* stav plnenia poradia */
+typedef struct {
+        int w;
+        int h;
+        uint32_t k;             /* ďalší voľný index tabuľky */
+        uint32_t *to_row;
+        uint32_t *to_id;
+} layout_fill_t;
+
+static void layout_put(layout_fill_t *f, int ix, int iy)
+{
+        uint32_t row = (uint32_t)iy * (uint32_t)f->w + (uint32_t)ix;
+        f->to_id[row] = f->k;
+        f->to_row[f->k] = row;
+        f->k++;
+}
+
+/* Z-poradie štvorca size x size s ľavým horným rohom (x0,y0);
+   časti mimo sveta sa preskočia, takže indexy ostanú husté */
+static void layout_morton(layout_fill_t *f, int x0, int y0, int size)
+{
+        if (x0 >= f->w || y0 >= f->h)
+                return;
+
+        /* 2x2 po riadkoch je už Z-poradie */
+        if (size == 2) {
+                for (int iy = y0; iy < y0 + 2 && iy < f->h; iy++)
+                        for (int ix = x0; ix < x0 + 2 && ix < f->w; ix++)
+                                layout_put(f, ix, iy);
+                return;
+        }
+
+        int half = size / 2;
+        layout_morton(f, x0, y0, half);
+        layout_morton(f, x0 + half, y0, half);
+        layout_morton(f, x0, y0 + half, half);
+        layout_morton(f, x0 + half, y0 + half, half);
+}
+
+/* prepočtové tabuľky medzi poradím po riadkoch a poradím layoutu */
+static int layout_build(grid_nbr_t *t, int layout)
+{
+        int w = t->width;
+        int h = t->height;
+        size_t total = (size_t)w * (size_t)h;
+
+        t->to_row = malloc(total * sizeof(uint32_t));
+        t->to_id = malloc(total * sizeof(uint32_t));
+        if (!t->to_row || !t->to_id)
+                return -1;
+
+        layout_fill_t f = {w, h, 0, t->to_row, t->to_id};
+
+        if (layout == GRID_LAYOUT_TILED) {
+                for (int ty = 0; ty < h; ty += GRID_TILE)
+                        for (int tx = 0; tx < w; tx += GRID_TILE)
+                                for (int iy = ty; iy < ty + GRID_TILE && iy < h; iy++)
+                                        for (int ix = tx; ix < tx + GRID_TILE && ix < w; ix++)
+                                                layout_put(&f, ix, iy);
+        } else {
+                int size = 2;
+                while (size < w || size < h)
+                        size *= 2;
+                layout_morton(&f, 0, 0, size);
+        }
+
+        return 0;
+}
+
+int grid_nbr_build(grid_nbr_t *t, const config *cfg, const uint64_t *obstacles)
+{
+        int w = cfg->world_width;
+        int h = cfg->world_height;
+        size_t total = grid_cells(cfg);
+
+        t->width = w;
+        t->height = h;
+        t->layout = cfg->layout;
+        t->to_row = NULL;
+        t->to_id = NULL;
+        t->next = malloc(total * 4 * sizeof(uint32_t));
+        if (!t->next) {
+                grid_nbr_free(t);
+                return -1;
+        }
+
+        if (t->layout != GRID_LAYOUT_ROWS && layout_build(t, t->layout) != 0) {
+                grid_nbr_free(t);
+                return -1;
+        }
+
+        t->origin = grid_nbr_id(t, (uint32_t)grid_idx_of(cfg, 0, 0));
+
+        for (int iy = 0; iy < h; iy++) {
+                /* riadok 0 je najvyššie y, takže "hore" je riadok vyššie v poli */
+                int up_row = (iy == 0) ? h - 1 : iy - 1;
+                int down_row = (iy == h - 1) ? 0 : iy + 1;
+
+                for (int ix = 0; ix < w; ix++) {
+                        uint32_t row = (uint32_t)(iy * w + ix);
+                        int left = (ix == 0) ? w - 1 : ix - 1;
+                        int right = (ix == w - 1) ? 0 : ix + 1;
+
+                        uint32_t nb[4];
+                        nb[GRID_UP] = (uint32_t)(up_row * w + ix);
+                        nb[GRID_DOWN] = (uint32_t)(down_row * w + ix);
+                        nb[GRID_LEFT] = (uint32_t)(iy * w + left);
+                        nb[GRID_RIGHT] = (uint32_t)(iy * w + right);
+
+                        uint32_t id = grid_nbr_id(t, row);
+                        uint32_t *n = &t->next[4 * (size_t)id];
+
+                        /* do prekážky sa nepohneme */
+                        int blocked = obstacles && bitmap_get(obstacles, row);
+                        for (int d = 0; d < 4; d++) {
+                                if (blocked || (obstacles && bitmap_get(obstacles, nb[d])))
+                                        n[d] = id;
+                                else
+                                        n[d] = grid_nbr_id(t, nb[d]);
+                        }
+                }
+        }
+
+        return 0;
+}
+
+void grid_nbr_free(grid_nbr_t *t)
+{
+        free(t->next);
+        free(t->to_row);
+        free(t->to_id);
+        t->next = NULL;
+        t->to_row = NULL;
+        t->to_id = NULL;
+}
+
+/* dst[map[i]] = src[i] pre prvky veľkosti elem */
+static void scatter(void *dst, const void *src, const uint32_t *map, size_t n, size_t elem)
+{
+        if (elem == sizeof(uint64_t)) {
+                const uint64_t *s = src;
+                uint64_t *d = dst;
+                for (size_t i = 0; i < n; i++)
+                        d[map[i]] = s[i];
+        } else if (elem == sizeof(uint32_t)) {
+                const uint32_t *s = src;
+                uint32_t *d = dst;
+                for (size_t i = 0; i < n; i++)
+                        d[map[i]] = s[i];
+        } else {
+                const uint8_t *s = src;
+                uint8_t *d = dst;
+                for (size_t i = 0; i < n; i++)
+                        memcpy(d + (size_t)map[i] * elem, s + i * elem, elem);
+        }
+}
+
+/* preusporiada a podľa map (na mieste cez dočasnú kópiu) */
+static int permute(const grid_nbr_t *t, void *a, size_t elem, const uint32_t *map)
+{
+        if (!map)
+                return 0;
+
+        size_t total = (size_t)t->width * (size_t)t->height;
+        void *tmp = malloc(total * elem);
+        if (!tmp)
+                return -1;
+
+        memcpy(tmp, a, total * elem);
+        scatter(a, tmp, map, total, elem);
+        free(tmp);
+        return 0;
+}
+
+int grid_nbr_permute(const grid_nbr_t *t, void *a, size_t elem)
+{
+        return permute(t, a, elem, t->to_id);
+}
+
+int grid_nbr_unpermute(const grid_nbr_t *t, void *a, size_t elem)
+{
+        return permute(t, a, elem, t->to_row);
+}
+
+uint64_t *grid_nbr_bitmap(const grid_nbr_t *t, const uint64_t *obstacles)
+{
+        if (!obstacles)
+                return NULL;
+
+        size_t total = (size_t)t->width * (size_t)t->height;
+        uint64_t *b = bitmap_alloc(total);
+        if (!b)
+                return NULL;
+
+        for (size_t row = 0; row < total; row++)
+                if (bitmap_get(obstacles, row))
+                        bitmap_set(b, grid_nbr_id(t, (uint32_t)row));
+        return b;
+}
+
+long grid_bfs_dist(const config *cfg, const uint64_t *obstacles, uint32_t *dist)
+{
+        int w = cfg->world_width;
+        int h = cfg->world_height;
+        size_t total = grid_cells(cfg);
+
+        uint32_t *queue = malloc(total * sizeof(uint32_t));
+        if (!queue)
+                return -1;
+
+        for (size_t i = 0; i < total; i++)
+                dist[i] = GRID_UNREACHABLE;
+
+        uint32_t origin = (uint32_t)grid_idx_of(cfg, 0, 0);
+        size_t head = 0, tail = 0;
+
+        if (!obstacles || !bitmap_get(obstacles, origin)) {
+                dist[origin] = 0;
+                queue[tail++] = origin;
+        }
+
+        /* pohyby sú symetrické, takže vzdialenosť od [0,0] = vzdialenosť do [0,0] */
+        while (head < tail) {
+                uint32_t id = queue[head++];
+                int ix = (int)(id % (uint32_t)w);
+                int iy = (int)(id / (uint32_t)w);
+
+                uint32_t nb[4];
+                nb[0] = (uint32_t)(((iy == 0) ? h - 1 : iy - 1) * w + ix);
+                nb[1] = (uint32_t)(((iy == h - 1) ? 0 : iy + 1) * w + ix);
+                nb[2] = (uint32_t)(iy * w + ((ix == 0) ? w - 1 : ix - 1));
+                nb[3] = (uint32_t)(iy * w + ((ix == w - 1) ? 0 : ix + 1));
+
+                for (int d = 0; d < 4; d++) {
+                        if (dist[nb[d]] != GRID_UNREACHABLE)
+                                continue;
+                        if (obstacles && bitmap_get(obstacles, nb[d]))
+                                continue;
+
+                        dist[nb[d]] = dist[id] + 1;
+                        queue[tail++] = nb[d];
+                }
+        }
+
+        free(queue);
+        return (long)tail;
+}
+
+int grid_clearance(const config *cfg, const uint64_t *obstacles, uint8_t *clear)
+{
+        int w = cfg->world_width;
+        int h = cfg->world_height;
+        size_t total = grid_cells(cfg);
+
+        uint32_t *queue = malloc(total * sizeof(uint32_t));
+        if (!queue)
+                return -1;
+
+        /* zdroje: cieľ a všetky prekážky, 255 = zatiaľ nenavštívené */
+        size_t head = 0, tail = 0;
+        for (size_t i = 0; i < total; i++) {
+                clear[i] = 255;
+                if (obstacles && bitmap_get(obstacles, i)) {
+                        clear[i] = 0;
+                        queue[tail++] = (uint32_t)i;
+                }
+        }
+
+        uint32_t origin = (uint32_t)grid_idx_of(cfg, 0, 0);
+        if (clear[origin] != 0) {
+                clear[origin] = 0;
+                queue[tail++] = origin;
+        }
+
+        /* BFS bez blokovania = Manhattanova vzdialenosť na toruse */
+        while (head < tail) {
+                uint32_t id = queue[head++];
+                if (clear[id] >= 254)
+                        continue;
+
+                int ix = (int)(id % (uint32_t)w);
+                int iy = (int)(id / (uint32_t)w);
+
+                uint32_t nb[4];
+                nb[0] = (uint32_t)(((iy == 0) ? h - 1 : iy - 1) * w + ix);
+                nb[1] = (uint32_t)(((iy == h - 1) ? 0 : iy + 1) * w + ix);
+                nb[2] = (uint32_t)(iy * w + ((ix == 0) ? w - 1 : ix - 1));
+                nb[3] = (uint32_t)(iy * w + ((ix == w - 1) ? 0 : ix + 1));
+
+                for (int d = 0; d < 4; d++) {
+                        if (clear[nb[d]] != 255)
+                                continue;
+                        clear[nb[d]] = (uint8_t)(clear[id] + 1);
+                        queue[tail++] = nb[d];
+                }
+        }
+
+        free(queue);
+        return 0;
+}
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "jump.h"
+
+#define JUMP_MAX_M 32
+#define JUMP_SPAN (2 * JUMP_MAX_M + 1)
+
+static const uint32_t jump_lengths[JUMP_LEVELS] = {4, 8, 16, 32};
+
+/* alias tabuľka (Vose) z rozdelenia w[0..n), súčet w je 1 */
+static int alias_build(jump_level_t *lv, const double *w)
+{
+        uint32_t n = lv->n;
+        double *scaled = malloc((size_t)n * sizeof(double));
+        uint32_t *small = malloc((size_t)n * sizeof(uint32_t));
+        uint32_t *large = malloc((size_t)n * sizeof(uint32_t));
+        if (!scaled || !small || !large) {
+                free(scaled);
+                free(small);
+                free(large);
+                return -1;
+        }
+
+        uint32_t ns = 0, nl = 0;
+        for (uint32_t i = 0; i < n; i++) {
+                scaled[i] = w[i] * (double)n;
+                if (scaled[i] < 1.0)
+                        small[ns++] = i;
+                else
+                        large[nl++] = i;
+        }
+
+        while (ns > 0 && nl > 0) {
+                uint32_t s = small[--ns];
+                uint32_t l = large[--nl];
+
+                lv->prob[s] = scaled[s];
+                lv->alias[s] = l;
+
+                scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+                if (scaled[l] < 1.0)
+                        small[ns++] = l;
+                else
+                        large[nl++] = l;
+        }
+
+        /* zvyšky sú kvôli zaokrúhleniu ~1 */
+        while (nl > 0) {
+                uint32_t l = large[--nl];
+                lv->prob[l] = 1.0;
+                lv->alias[l] = l;
+        }
+        while (ns > 0) {
+                uint32_t s = small[--ns];
+                lv->prob[s] = 1.0;
+                lv->alias[s] = s;
+        }
+
+        free(scaled);
+        free(small);
+        free(large);
+        return 0;
+}
+
+/* z rozdelenia na mriežke posunov vyberie nenulové a postaví tabuľku */
+static int level_build(jump_level_t *lv, uint32_t m, const double *grid)
+{
+        uint32_t n = 0;
+        for (int i = 0; i < JUMP_SPAN * JUMP_SPAN; i++)
+                if (grid[i] > 0.0)
+                        n++;
+
+        lv->m = m;
+        lv->n = n;
+        lv->prob = malloc((size_t)n * sizeof(double));
+        lv->alias = malloc((size_t)n * sizeof(uint32_t));
+        lv->drow = malloc((size_t)n * sizeof(int32_t));
+        lv->dcol = malloc((size_t)n * sizeof(int32_t));
+        double *w = malloc((size_t)n * sizeof(double));
+        if (!lv->prob || !lv->alias || !lv->drow || !lv->dcol || !w) {
+                free(w);
+                return -1;
+        }
+
+        double sum = 0.0;
+        uint32_t k = 0;
+        for (int r = 0; r < JUMP_SPAN; r++) {
+                for (int c = 0; c < JUMP_SPAN; c++) {
+                        double v = grid[r * JUMP_SPAN + c];
+                        if (v <= 0.0)
+                                continue;
+                        lv->drow[k] = r - JUMP_MAX_M;
+                        lv->dcol[k] = c - JUMP_MAX_M;
+                        w[k] = v;
+                        sum += v;
+                        k++;
+                }
+        }
+        for (uint32_t i = 0; i < n; i++)
+                w[i] /= sum;
+
+        int rc = alias_build(lv, w);
+        free(w);
+        return rc;
+}
+
+int jump_build(jump_table_t *t, const probabilities_t *p)
+{
+        memset(t, 0, sizeof(*t));
+
+        /* rozdelenie posunu po k krokoch, stred mriežky = (0,0) */
+        double *cur = calloc(JUMP_SPAN * JUMP_SPAN, sizeof(double));
+        double *nxt = calloc(JUMP_SPAN * JUMP_SPAN, sizeof(double));
+        if (!cur || !nxt) {
+                free(cur);
+                free(nxt);
+                return -1;
+        }
+
+        cur[JUMP_MAX_M * JUMP_SPAN + JUMP_MAX_M] = 1.0;
+
+        int level = 0;
+        for (uint32_t k = 1; k <= JUMP_MAX_M; k++) {
+                memset(nxt, 0, JUMP_SPAN * JUMP_SPAN * sizeof(double));
+
+                /* po k-1 krokoch je posun najviac k-1, takže okraj mriežky sa nepreteká */
+                int lo = JUMP_MAX_M - (int)(k - 1);
+                int hi = JUMP_MAX_M + (int)(k - 1);
+                for (int r = lo; r <= hi; r++) {
+                        for (int c = lo; c <= hi; c++) {
+                                double v = cur[r * JUMP_SPAN + c];
+                                if (v == 0.0)
+                                        continue;
+                                nxt[(r - 1) * JUMP_SPAN + c] += v * p->p_up;
+                                nxt[(r + 1) * JUMP_SPAN + c] += v * p->p_down;
+                                nxt[r * JUMP_SPAN + c - 1] += v * p->p_left;
+                                nxt[r * JUMP_SPAN + c + 1] += v * p->p_right;
+                        }
+                }
+
+                double *tmp = cur;
+                cur = nxt;
+                nxt = tmp;
+
+                if (level < JUMP_LEVELS && k == jump_lengths[level]) {
+                        if (level_build(&t->lv[level], k, cur) != 0) {
+                                free(cur);
+                                free(nxt);
+                                jump_free(t);
+                                return -1;
+                        }
+                        level++;
+                }
+        }
+
+        free(cur);
+        free(nxt);
+        return 0;
+}
+
+void jump_free(jump_table_t *t)
+{
+        for (int l = 0; l < JUMP_LEVELS; l++) {
+                free(t->lv[l].prob);
+                free(t->lv[l].alias);
+                free(t->lv[l].drow);
+                free(t->lv[l].dcol);
+        }
+        memset(t, 0, sizeof(*t));
+}
@@ -1,8 +1,14 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 
@@ -33,7 +39,7 @@ int net_listen_unix(const char *path)
         exit(1);
     }
 
-    if (listen(sock_fd, 1) == -1) {
+    if (listen(sock_fd, SOMAXCONN) == -1) {
         perror("listen");
         close(sock_fd);
         exit(1);
@@ -45,12 +51,19 @@ int net_listen_unix(const char *path)
 /* prijme nové pripojenie */
 int net_accept(int listen_fd)
 {
-    int client_fd = accept(listen_fd, NULL, NULL);
+    /* neblokujúci a s FD_CLOEXEC hneď od vzniku, inak by ho zdedil fork workera */
+    int client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (client_fd == -1) {
-        perror("accept");
-        exit(1);
+        /* na neblokujúcom sockete už nikto nečaká; chyba pri jednom pripojení server neukončí */
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            perror("accept");
+        return -1;
     }
 
+    /* pri TCP bez Naglovho zdržania malých správ; pri UNIX sockete to zlyhá a nevadí */
+    int one = 1;
+    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
     return client_fd;
 }
 
@@ -77,3 +90,144 @@ int net_connect_unix(const char *path)
     return sock_fd;
 }
 
+
+/* spoločná časť TCP: prejde adresy z getaddrinfo, kým jedna nevyjde */
+static int tcp_open(const char *host, const char *port, int listening)
+{
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+    struct addrinfo *list = NULL;
+    int rc = getaddrinfo(host && host[0] ? host : NULL, port, &hints, &list);
+    if (rc != 0) {
+        fprintf(stderr, "getaddrinfo %s:%s: %s\n", host ? host : "", port, gai_strerror(rc));
+        return -1;
+    }
+
+    int sock_fd = -1;
+    for (struct addrinfo *ai = list; ai; ai = ai->ai_next) {
+        sock_fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock_fd == -1)
+            continue;
+
+        int one = 1;
+        if (listening) {
+            /* reštart servera nečaká na TIME_WAIT */
+            setsockopt(sock_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(sock_fd, ai->ai_addr, ai->ai_addrlen) == 0 && listen(sock_fd, SOMAXCONN) == 0)
+                break;
+        } else if (connect(sock_fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            setsockopt(sock_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            break;
+        }
+
+        close(sock_fd);
+        sock_fd = -1;
+    }
+
+    if (sock_fd == -1)
+        perror(listening ? "tcp listen" : "tcp connect");
+
+    freeaddrinfo(list);
+    return sock_fd;
+}
+
+int net_listen_tcp(const char *host, const char *port)
+{
+    return tcp_open(host, port, 1);
+}
+
+int net_connect_tcp(const char *host, const char *port)
+{
+    return tcp_open(host, port, 0);
+}
+
+/* rozdelí "host:port" alebo "[v6]:port"; 0 ok, -1 zlá adresa */
+static int split_host_port(const char *hp, char *host, size_t hn, char *port, size_t pn)
+{
+    const char *colon;
+    const char *h = hp;
+    size_t hl;
+
+    if (hp[0] == '[') {
+        const char *end = strchr(hp, ']');
+        if (!end || end[1] != ':')
+            return -1;
+        h = hp + 1;
+        hl = (size_t)(end - h);
+        colon = end + 1;
+    } else {
+        colon = strrchr(hp, ':');
+        if (!colon)
+            return -1;
+        hl = (size_t)(colon - hp);
+    }
+
+    if (hl >= hn || strlen(colon + 1) >= pn || colon[1] == '\0')
+        return -1;
+
+    memcpy(host, h, hl);
+    host[hl] = '\0';
+    snprintf(port, pn, "%s", colon + 1);
+    return 0;
+}
+
+int net_listen(const char *addr)
+{
+    char host[256], port[32];
+
+    if (strncmp(addr, "tcp:", 4) == 0) {
+        if (split_host_port(addr + 4, host, sizeof(host), port, sizeof(port)) != 0)
+            return -1;
+        return net_listen_tcp(host, port);
+    }
+    if (strncmp(addr, "unix:", 5) == 0)
+        addr += 5;
+    return net_listen_unix(addr);
+}
+
+int net_connect(const char *addr)
+{
+    char host[256], port[32];
+
+    if (strncmp(addr, "tcp:", 4) == 0) {
+        if (split_host_port(addr + 4, host, sizeof(host), port, sizeof(port)) != 0)
+            return -1;
+        return net_connect_tcp(host, port);
+    }
+    if (strncmp(addr, "unix:", 5) == 0)
+        addr += 5;
+    return net_connect_unix(addr);
+}
+
+int net_local_addr(int fd, char *out, size_t n)
+{
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    if (getsockname(fd, (struct sockaddr *)&ss, &len) != 0)
+        return -1;
+
+    char host[256], port[32];
+    if (getnameinfo((struct sockaddr *)&ss, len, host, sizeof(host), port, sizeof(port),
+                    NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+        return -1;
+
+    if (ss.ss_family == AF_INET6)
+        snprintf(out, n, "tcp:[%s]:%s", host, port);
+    else
+        snprintf(out, n, "tcp:%s:%s", host, port);
+    return 0;
+}
+
+/* klient je na tom istom stroji (UNIX socket), môže dostať fd cez SCM_RIGHTS */
+int net_is_local(int fd)
+{
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    if (getsockname(fd, (struct sockaddr *)&ss, &len) != 0)
+        return 0;
+    return ss.ss_family == AF_UNIX;
+}
@@ -0,0 +1,516 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "numfmt.h"
+
+/* Ryu (Ulf Adams, PLDI 2018) na zápis a Eisel-Lemire (Go strconv, fast_float) na čítanie;
+   obe potrebujú 128-bitové mocniny 5, tie sa raz vyrátajú presne cez veľké čísla */
+
+__extension__ typedef unsigned __int128 u128_t;
+
+#define RYU_POW5_SIZE 326       /* 5^i pre záporné binárne exponenty */
+#define RYU_POW5_INV_SIZE 342   /* 2^k / 5^q pre kladné */
+#define RYU_POW5_BITCOUNT 125
+
+#define LEMIRE_MIN_EXP10 (-342)
+#define LEMIRE_MAX_EXP10 308
+
+static uint64_t ryu_pow5[RYU_POW5_SIZE][2];             /* [0] dolných 64 bitov, [1] horných */
+static uint64_t ryu_pow5_inv[RYU_POW5_INV_SIZE][2];
+static uint64_t lemire_pow10[LEMIRE_MAX_EXP10 - LEMIRE_MIN_EXP10 + 1][2];
+
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+/* veľké číslo na výpočet tabuliek (32-bitové slová od najnižšieho) */
+#define BIG_WORDS 40
+#define BIG_SHIFT 1024          /* 2^BIG_SHIFT / 5^k drží dosť bitov aj pre 5^342 */
+
+typedef struct {
+        uint32_t w[BIG_WORDS];
+} big_t;
+
+static void big_mul5(big_t *a)
+{
+        uint64_t carry = 0;
+        for (int i = 0; i < BIG_WORDS; i++) {
+                uint64_t t = (uint64_t)a->w[i] * 5 + carry;
+                a->w[i] = (uint32_t)t;
+                carry = t >> 32;
+        }
+}
+
+static void big_div5(big_t *a)
+{
+        uint64_t rem = 0;
+        for (int i = BIG_WORDS - 1; i >= 0; i--) {
+                uint64_t cur = (rem << 32) | a->w[i];
+                a->w[i] = (uint32_t)(cur / 5);
+                rem = cur % 5;
+        }
+}
+
+static int big_bits(const big_t *a)
+{
+        for (int i = BIG_WORDS - 1; i >= 0; i--)
+                if (a->w[i])
+                        return i * 32 + 32 - __builtin_clz(a->w[i]);
+        return 0;
+}
+
+/* a >> shift (záporný shift = posun doľava), výsledok musí mať najviac 128 bitov */
+static u128_t big_shr(const big_t *a, int shift)
+{
+        u128_t r = 0;
+        for (int i = 0; i < BIG_WORDS; i++) {
+                int pos = i * 32 - shift;
+                if (!a->w[i] || pos <= -32 || pos >= 128)
+                        continue;
+                r |= (pos >= 0) ? (u128_t)a->w[i] << pos : (u128_t)(a->w[i] >> -pos);
+        }
+        return r;
+}
+
+static void store128(uint64_t dst[2], u128_t v)
+{
+        dst[0] = (uint64_t)v;
+        dst[1] = (uint64_t)(v >> 64);
+}
+
+/* počet bitov 5^e (pre 0 <= e <= 3528) */
+static int pow5bits(int e)
+{
+        return (int)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+static void init_tables(void)
+{
+        /* kladné mocniny: 5^i zarovnané na 128 bitov (dolu), Ryu z nich berie 125 */
+        big_t p;
+        memset(&p, 0, sizeof(p));
+        p.w[0] = 1;
+        for (int i = 0; i < RYU_POW5_SIZE; i++) {
+                u128_t top = big_shr(&p, big_bits(&p) - 128);
+                if (i <= LEMIRE_MAX_EXP10)
+                        store128(lemire_pow10[i - LEMIRE_MIN_EXP10], top);
+                store128(ryu_pow5[i], top >> 3);
+                big_mul5(&p);
+        }
+
+        /* záporné: floor(2^BIG_SHIFT / 5^k), z toho posunom floor(2^j / 5^k) pre každé j */
+        big_t x;
+        memset(&x, 0, sizeof(x));
+        x.w[BIG_SHIFT / 32] = 1;
+        for (int k = 0; k <= -LEMIRE_MIN_EXP10; k++) {
+                int len = pow5bits(k);
+                if (k < RYU_POW5_INV_SIZE)
+                        store128(ryu_pow5_inv[k], big_shr(&x, BIG_SHIFT - (len - 1 + RYU_POW5_BITCOUNT)) + 1);
+                if (k > 0)
+                        store128(lemire_pow10[-k - LEMIRE_MIN_EXP10], big_shr(&x, BIG_SHIFT - (len + 127)));
+                big_div5(&x);
+        }
+}
+
+/* --- zápis (Ryu d2d) --- */
+
+static uint32_t log10_pow2(int e)
+{
+        return ((uint32_t)e * 78913) >> 18;
+}
+
+static uint32_t log10_pow5(int e)
+{
+        return ((uint32_t)e * 732923) >> 20;
+}
+
+static int multiple_of_pow5(uint64_t v, uint32_t p)
+{
+        uint32_t count = 0;
+        while (v % 5 == 0) {
+                v /= 5;
+                count++;
+        }
+        return count >= p;
+}
+
+static int multiple_of_pow2(uint64_t v, uint32_t p)
+{
+        return (v & ((1ULL << p) - 1)) == 0;
+}
+
+static uint64_t mul_shift(uint64_t m, const uint64_t mul[2], int j)
+{
+        u128_t b0 = (u128_t)m * mul[0];
+        u128_t b2 = (u128_t)m * mul[1];
+        return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+}
+
+/* najkratšie desiatkové číslice (digits * 10^exp) pre kladné konečné číslo */
+static void ryu_d2d(uint64_t ieee_mantissa, uint32_t ieee_exponent, uint64_t *digits, int *exp)
+{
+        int e2;
+        uint64_t m2;
+        if (ieee_exponent == 0) {
+                e2 = 1 - 1023 - 52 - 2;
+                m2 = ieee_mantissa;
+        } else {
+                e2 = (int)ieee_exponent - 1023 - 52 - 2;
+                m2 = (1ULL << 52) | ieee_mantissa;
+        }
+        int accept_bounds = (m2 & 1) == 0;
+
+        /* interval hodnôt, ktoré sa načítajú späť na to isté číslo */
+        uint64_t mv = 4 * m2;
+        uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+
+        uint64_t vr, vp, vm;
+        int e10;
+        int vm_trailing_zeros = 0, vr_trailing_zeros = 0;
+
+        if (e2 >= 0) {
+                uint32_t q = log10_pow2(e2) - (e2 > 3);
+                e10 = (int)q;
+                int k = RYU_POW5_BITCOUNT + pow5bits((int)q) - 1;
+                int i = -e2 + (int)q + k;
+                vr = mul_shift(4 * m2, ryu_pow5_inv[q], i);
+                vp = mul_shift(4 * m2 + 2, ryu_pow5_inv[q], i);
+                vm = mul_shift(4 * m2 - 1 - mm_shift, ryu_pow5_inv[q], i);
+                if (q <= 21) {
+                        if (mv % 5 == 0)
+                                vr_trailing_zeros = multiple_of_pow5(mv, q);
+                        else if (accept_bounds)
+                                vm_trailing_zeros = multiple_of_pow5(mv - 1 - mm_shift, q);
+                        else
+                                vp -= multiple_of_pow5(mv + 2, q);
+                }
+        } else {
+                uint32_t q = log10_pow5(-e2) - (-e2 > 1);
+                e10 = (int)q + e2;
+                int i = -e2 - (int)q;
+                int k = pow5bits(i) - RYU_POW5_BITCOUNT;
+                int j = (int)q - k;
+                vr = mul_shift(4 * m2, ryu_pow5[i], j);
+                vp = mul_shift(4 * m2 + 2, ryu_pow5[i], j);
+                vm = mul_shift(4 * m2 - 1 - mm_shift, ryu_pow5[i], j);
+                if (q <= 1) {
+                        vr_trailing_zeros = 1;
+                        if (accept_bounds)
+                                vm_trailing_zeros = mm_shift == 1;
+                        else
+                                vp--;
+                } else if (q < 63) {
+                        vr_trailing_zeros = multiple_of_pow2(mv, q);
+                }
+        }
+
+        /* odoberáme číslice, kým je interval širší ako jedna jednotka */
+        int removed = 0;
+        uint64_t output;
+        if (vm_trailing_zeros || vr_trailing_zeros) {
+                uint8_t last = 0;
+                while (vp / 10 > vm / 10) {
+                        vm_trailing_zeros &= vm % 10 == 0;
+                        vr_trailing_zeros &= last == 0;
+                        last = (uint8_t)(vr % 10);
+                        vr /= 10;
+                        vp /= 10;
+                        vm /= 10;
+                        removed++;
+                }
+                if (vm_trailing_zeros) {
+                        while (vm % 10 == 0) {
+                                vr_trailing_zeros &= last == 0;
+                                last = (uint8_t)(vr % 10);
+                                vr /= 10;
+                                vp /= 10;
+                                vm /= 10;
+                                removed++;
+                        }
+                }
+                /* presne v polovici sa zaokrúhľuje na párnu */
+                if (vr_trailing_zeros && last == 5 && vr % 2 == 0)
+                        last = 4;
+                output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last >= 5);
+        } else {
+                int round_up = 0;
+                if (vp / 100 > vm / 100) {
+                        round_up = vr % 100 >= 50;
+                        vr /= 100;
+                        vp /= 100;
+                        vm /= 100;
+                        removed += 2;
+                }
+                while (vp / 10 > vm / 10) {
+                        round_up = vr % 10 >= 5;
+                        vr /= 10;
+                        vp /= 10;
+                        vm /= 10;
+                        removed++;
+                }
+                output = vr + (vr == vm || round_up);
+        }
+
+        *digits = output;
+        *exp = e10 + removed;
+}
+
+size_t numfmt_double(char *out, double v)
+{
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        int neg = (int)(bits >> 63);
+        uint64_t mantissa = bits & ((1ULL << 52) - 1);
+        uint32_t exponent = (uint32_t)((bits >> 52) & 0x7ff);
+
+        char *o = out;
+        if (neg)
+                *o++ = '-';
+
+        /* rovnako ako printf */
+        if (exponent == 0x7ff) {
+                memcpy(o, mantissa ? "nan" : "inf", 4);
+                return (size_t)(o - out) + 3;
+        }
+        if (exponent == 0 && mantissa == 0) {
+                *o++ = '0';
+                *o = '\0';
+                return (size_t)(o - out);
+        }
+
+        pthread_once(&tables_once, init_tables);
+
+        uint64_t digits;
+        int exp;
+        ryu_d2d(mantissa, exponent, &digits, &exp);
+
+        /* číslice odzadu na koniec buf, d ukazuje na prvú */
+        char buf[20];
+        char *d = buf + sizeof(buf);
+        do {
+                *--d = (char)('0' + digits % 10);
+                digits /= 10;
+        } while (digits > 0);
+        int n = (int)(buf + sizeof(buf) - d);
+
+        /* exponent prvej číslice rozhoduje o tvare ako pri %.17g */
+        int x = exp + n - 1;
+        if (x < -4 || x >= 17) {
+                *o++ = d[0];
+                if (n > 1) {
+                        *o++ = '.';
+                        memcpy(o, d + 1, (size_t)(n - 1));
+                        o += n - 1;
+                }
+                *o++ = 'e';
+                *o++ = x < 0 ? '-' : '+';
+                int ax = x < 0 ? -x : x;
+                if (ax >= 100)
+                        *o++ = (char)('0' + ax / 100);
+                *o++ = (char)('0' + ax / 10 % 10);
+                *o++ = (char)('0' + ax % 10);
+        } else if (x < 0) {
+                *o++ = '0';
+                *o++ = '.';
+                for (int i = 0; i < -x - 1; i++)
+                        *o++ = '0';
+                memcpy(o, d, (size_t)n);
+                o += n;
+        } else if (n <= x + 1) {
+                memcpy(o, d, (size_t)n);
+                o += n;
+                for (int i = 0; i < x + 1 - n; i++)
+                        *o++ = '0';
+        } else {
+                memcpy(o, d, (size_t)(x + 1));
+                o += x + 1;
+                *o++ = '.';
+                memcpy(o, d + x + 1, (size_t)(n - x - 1));
+                o += n - x - 1;
+        }
+
+        *o = '\0';
+        return (size_t)(o - out);
+}
+
+/* --- čítanie --- */
+
+static const double exact_pow10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* man * 10^exp10 správne zaokrúhlené; 0, ak sa to nedá rozhodnúť bez presného výpočtu */
+static int eisel_lemire(uint64_t man, int64_t exp10, double *out)
+{
+        if (exp10 < LEMIRE_MIN_EXP10 || exp10 > LEMIRE_MAX_EXP10)
+                return 0;
+
+        int clz = __builtin_clzll(man);
+        man <<= clz;
+        uint64_t ret_exp2 = (uint64_t)(((217706 * exp10) >> 16) + 64 + 1023) - (uint64_t)clz;
+
+        const uint64_t *pw = lemire_pow10[exp10 - LEMIRE_MIN_EXP10];
+        u128_t xp = (u128_t)man * pw[1];
+        uint64_t x_hi = (uint64_t)(xp >> 64);
+        uint64_t x_lo = (uint64_t)xp;
+
+        /* dolných 64 bitov mocniny treba, len ak je horný súčin na hrane */
+        if ((x_hi & 0x1ff) == 0x1ff && x_lo + man < man) {
+                u128_t yp = (u128_t)man * pw[0];
+                uint64_t y_hi = (uint64_t)(yp >> 64);
+                uint64_t y_lo = (uint64_t)yp;
+                uint64_t merged_hi = x_hi;
+                uint64_t merged_lo = x_lo + y_hi;
+                if (merged_lo < x_lo)
+                        merged_hi++;
+                if ((merged_hi & 0x1ff) == 0x1ff && merged_lo + 1 == 0 && y_lo + man < man)
+                        return 0;
+                x_hi = merged_hi;
+                x_lo = merged_lo;
+        }
+
+        uint64_t msb = x_hi >> 63;
+        uint64_t mant = x_hi >> (msb + 9);
+        ret_exp2 -= 1 ^ msb;
+
+        /* presne v polovici medzi dvoma double */
+        if (x_lo == 0 && (x_hi & 0x1ff) == 0 && (mant & 3) == 1)
+                return 0;
+
+        mant += mant & 1;
+        mant >>= 1;
+        if (mant >> 53) {
+                mant >>= 1;
+                ret_exp2++;
+        }
+
+        /* subnormálne čísla a pretečenie nechá na strtod */
+        if (ret_exp2 - 1 >= 0x7ff - 1)
+                return 0;
+
+        uint64_t bits = (ret_exp2 << 52) | (mant & ((1ULL << 52) - 1));
+        memcpy(out, &bits, sizeof(bits));
+        return 1;
+}
+
+/* pomalá cesta: strtod na presne [s, e) */
+static const char *parse_slow(const char *s, const char *e, double *out)
+{
+        char buf[128];
+        size_t n = (size_t)(e - s);
+        char *tmp = (n < sizeof(buf)) ? buf : malloc(n + 1);
+        if (!tmp || n == 0) {
+                if (tmp != buf)
+                        free(tmp);
+                return NULL;
+        }
+        memcpy(tmp, s, n);
+        tmp[n] = '\0';
+
+        char *stop;
+        *out = strtod(tmp, &stop);
+        int ok = stop == tmp + n;
+        if (tmp != buf)
+                free(tmp);
+        return ok ? e : NULL;
+}
+
+static int is_digit(char c)
+{
+        return c >= '0' && c <= '9';
+}
+
+const char *numfmt_parse_double(const char *p, const char *end, double *out)
+{
+        const char *start = p;
+        int neg = 0;
+        if (p < end && (*p == '-' || *p == '+')) {
+                neg = *p == '-';
+                p++;
+        }
+
+        /* najviac 19 platných číslic sa zmestí do uint64 */
+        uint64_t man = 0;
+        int digits = 0;
+        int64_t exp10 = 0;
+        int any = 0, dropped = 0;
+
+        for (; p < end && is_digit(*p); p++) {
+                any = 1;
+                if (man == 0 && *p == '0')
+                        continue;
+                if (digits < 19) {
+                        man = man * 10 + (uint64_t)(*p - '0');
+                        digits++;
+                } else {
+                        exp10++;
+                        dropped |= *p != '0';
+                }
+        }
+        if (p < end && *p == '.') {
+                for (p++; p < end && is_digit(*p); p++) {
+                        any = 1;
+                        if (man == 0 && *p == '0') {
+                                exp10--;
+                                continue;
+                        }
+                        if (digits < 19) {
+                                man = man * 10 + (uint64_t)(*p - '0');
+                                digits++;
+                                exp10--;
+                        } else {
+                                dropped |= *p != '0';
+                        }
+                }
+        }
+
+        /* inf, nan a podobne */
+        if (!any) {
+                const char *e = start;
+                while (e < end && (is_digit(*e) || (*e >= 'a' && *e <= 'z') || (*e >= 'A' && *e <= 'Z') ||
+                                   *e == '+' || *e == '-' || *e == '.' || *e == '(' || *e == ')' || *e == '_'))
+                        e++;
+                return parse_slow(start, e, out);
+        }
+
+        /* exponent; samotné 'e' bez číslic k číslu nepatrí (ako pri strtod) */
+        if (p < end && (*p == 'e' || *p == 'E')) {
+                const char *q = p + 1;
+                int eneg = 0;
+                if (q < end && (*q == '+' || *q == '-')) {
+                        eneg = *q == '-';
+                        q++;
+                }
+                if (q < end && is_digit(*q)) {
+                        int64_t e = 0;
+                        for (; q < end && is_digit(*q); q++)
+                                if (e < 100000)
+                                        e = e * 10 + (*q - '0');
+                        exp10 += eneg ? -e : e;
+                        p = q;
+                }
+        }
+
+        if (dropped)
+                return parse_slow(start, p, out);
+
+        if (man == 0) {
+                *out = neg ? -0.0 : 0.0;
+                return p;
+        }
+
+        double v;
+        if (man <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+                /* obe čísla sú presné, jedna operácia zaokrúhli správne */
+                v = (double)man;
+                v = (exp10 < 0) ? v / exact_pow10[-exp10] : v * exact_pow10[exp10];
+        } else {
+                pthread_once(&tables_once, init_tables);
+                if (!eisel_lemire(man, exp10, &v))
+                        return parse_slow(start, p, out);
+        }
+
+        *out = neg ? -v : v;
+        return p;
+}
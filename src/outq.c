@@ -0,0 +1,815 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+
+#include "outq.h"
+#include "net.h"
+
+/* nad toľko položiek vo fronte klient zaostáva aj s malými správami */
+#define OUTQ_MAX_ITEMS 256
+
+/* najviac bajtov jednému klientovi na jedno zobudenie, aby sa zámok často uvoľňoval */
+#define OUTQ_BURST (4u * MSG_CHUNK_MAX)
+
+/* najdlhšia správa od klienta (config) */
+#define OUTQ_IN_MAX (64u * 1024)
+
+/* udalostí z jedného epoll_wait */
+#define OUTQ_EVENTS 256
+
+/* najviac úsekov (hlavičky a dáta) v jednom sendmsg */
+#define OUTQ_IOV 64
+
+/* hlavičky jedného kúska v prúde */
+#define OUTQ_CHUNK_HEAD (sizeof(msg_header_t) + sizeof(msg_chunk_t))
+
+struct outq_buf {
+        int refs;               /* atomicky: volajúci + položky vo frontoch */
+        msg_type_t type;
+        int chunked;
+        uint64_t total;         /* bajty dát */
+        uint64_t encoded;       /* bajty prúdu aj s hlavičkami */
+        int file_fd;            /* >= 0: dáta idú zo súboru od file_off (vlastná kópia fd) */
+        int pass_fd;            /* >= 0: ide s prvým bajtom cez SCM_RIGHTS (vlastná kópia fd) */
+        off_t file_off;
+        uint8_t *data;          /* kópia dát za hlavičkami (NULL pri súbore) */
+        uint8_t head[];         /* hlavičky kúskov za sebou */
+};
+
+/* jeden prenos vo fronte klienta */
+struct outq_item {
+        outq_item_t *next;
+        outq_buf_t *buf;
+        outq_class_t cls;
+        uint64_t pos;           /* už odoslané bajty prúdu */
+};
+
+/* úsek prúdu na pozícii pos: kúsok k, pozícia v ňom a rozsah jeho dát */
+typedef struct {
+        uint64_t k;
+        uint64_t in_part;
+        uint64_t data_off;
+        uint64_t data_len;
+        uint64_t head_len;
+} outq_seg_t;
+
+static outq_seg_t buf_seg(const outq_buf_t *b, uint64_t pos)
+{
+        outq_seg_t g;
+        if (b->chunked) {
+                uint64_t per = OUTQ_CHUNK_HEAD + MSG_CHUNK_MAX;
+                g.k = pos / per;
+                g.in_part = pos % per;
+                g.data_off = g.k * MSG_CHUNK_MAX;
+                g.data_len = b->total - g.data_off;
+                if (g.data_len > MSG_CHUNK_MAX)
+                        g.data_len = MSG_CHUNK_MAX;
+                g.head_len = OUTQ_CHUNK_HEAD;
+        } else {
+                g.k = 0;
+                g.in_part = pos;
+                g.data_off = 0;
+                g.data_len = b->total;
+                g.head_len = sizeof(msg_header_t);
+        }
+        return g;
+}
+
+outq_buf_t *outq_frame(msg_type_t type, int chunked, const void *data, uint64_t total,
+                       const sim_mapping_t *map)
+{
+        const uint8_t *bytes = (const uint8_t *)data;
+        const uint8_t *base = map ? (const uint8_t *)map->base : NULL;
+        int file_fd = -1;
+
+        /* súbor môže byť odmapovaný skôr, než sa správa dopošle, preto vlastný fd */
+        if (base && total > 0 && bytes >= base && bytes + total <= base + map->len)
+                file_fd = fcntl(map->fd, F_DUPFD_CLOEXEC, 0);
+
+        /* aj prázdny prenos má jeden kúsok, aby klient vedel, že skončil */
+        uint64_t chunks = 1;
+        if (chunked && total > 0)
+                chunks = (total + MSG_CHUNK_MAX - 1) / MSG_CHUNK_MAX;
+        size_t head_len = chunked ? OUTQ_CHUNK_HEAD : sizeof(msg_header_t);
+        uint64_t copy = file_fd >= 0 ? 0 : total;
+
+        if (copy > SIZE_MAX - sizeof(outq_buf_t) - chunks * head_len)
+                return NULL;
+
+        outq_buf_t *b = malloc(sizeof(*b) + (size_t)(chunks * head_len + copy));
+        if (!b) {
+                if (file_fd >= 0)
+                        close(file_fd);
+                return NULL;
+        }
+
+        b->refs = 1;
+        b->type = type;
+        b->chunked = chunked;
+        b->total = total;
+        b->encoded = chunks * head_len + total;
+        b->file_fd = file_fd;
+        b->pass_fd = -1;
+        b->file_off = file_fd >= 0 ? (off_t)(bytes - base) : 0;
+        b->data = file_fd >= 0 ? NULL : b->head + chunks * head_len;
+
+        for (uint64_t k = 0; k < chunks; k++) {
+                uint8_t *h = b->head + k * head_len;
+                msg_header_t hdr;
+                hdr.type = type;
+                if (chunked) {
+                        msg_chunk_t ch;
+                        ch.total = total;
+                        ch.offset = k * MSG_CHUNK_MAX;
+                        ch.seq = (uint32_t)k;
+                        ch.last = (k + 1 == chunks);
+                        uint64_t n = total - ch.offset;
+                        if (n > MSG_CHUNK_MAX)
+                                n = MSG_CHUNK_MAX;
+                        hdr.size = (uint32_t)(sizeof(ch) + n);
+                        memcpy(h + sizeof(hdr), &ch, sizeof(ch));
+                } else {
+                        hdr.size = (uint32_t)total;
+                }
+                memcpy(h, &hdr, sizeof(hdr));
+        }
+
+        if (copy > 0)
+                memcpy(b->data, bytes, (size_t)copy);
+        return b;
+}
+
+outq_buf_t *outq_frame_fd(msg_type_t type, const void *payload, uint32_t size, int fd)
+{
+        outq_buf_t *b = outq_frame(type, 0, payload, size, NULL);
+        if (!b)
+                return NULL;
+        b->pass_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (b->pass_fd < 0) {
+                free(b);
+                return NULL;
+        }
+        return b;
+}
+
+void outq_release(outq_buf_t *b)
+{
+        if (!b || __atomic_sub_fetch(&b->refs, 1, __ATOMIC_ACQ_REL) != 0)
+                return;
+        if (b->file_fd >= 0)
+                close(b->file_fd);
+        if (b->pass_fd >= 0)
+                close(b->pass_fd);
+        free(b);
+}
+
+static outq_item_t *item_new(outq_buf_t *b, outq_class_t cls)
+{
+        outq_item_t *it = malloc(sizeof(*it));
+        if (!it)
+                return NULL;
+        __atomic_add_fetch(&b->refs, 1, __ATOMIC_RELAXED);
+        it->next = NULL;
+        it->buf = b;
+        it->cls = cls;
+        it->pos = 0;
+        return it;
+}
+
+static void item_free(outq_item_t *it)
+{
+        outq_release(it->buf);
+        free(it);
+}
+
+/* úseky prúdu správy v pamäti od pos do iov (najviac max), vráti ich počet */
+static int buf_iov(outq_buf_t *b, uint64_t pos, struct iovec *iov, int max, uint64_t *bytes)
+{
+        int n = 0;
+        while (pos < b->encoded && n < max) {
+                outq_seg_t g = buf_seg(b, pos);
+                uint64_t len;
+                if (g.in_part < g.head_len) {
+                        iov[n].iov_base = b->head + g.k * g.head_len + g.in_part;
+                        len = g.head_len - g.in_part;
+                } else {
+                        uint64_t done = g.in_part - g.head_len;
+                        iov[n].iov_base = b->data + g.data_off + done;
+                        len = g.data_len - done;
+                }
+                iov[n++].iov_len = (size_t)len;
+                pos += len;
+                *bytes += len;
+        }
+        return n;
+}
+
+/* pošle zo správy so súborom, koľko socket zoberie (1 = celá odoslaná,
+   0 = plný socket (*blocked = 1) alebo minutý budget, -1 = chyba) */
+static int item_send_file(int fd, outq_item_t *it, uint64_t *budget, int *blocked)
+{
+        outq_buf_t *b = it->buf;
+
+        while (it->pos < b->encoded) {
+                if (*budget == 0)
+                        return 0;
+
+                outq_seg_t g = buf_seg(b, it->pos);
+                ssize_t n;
+                if (g.in_part < g.head_len) {
+                        /* MSG_MORE: hlavička ide v jednom segmente s dátami */
+                        n = send(fd, b->head + g.k * g.head_len + g.in_part, (size_t)(g.head_len - g.in_part),
+                                 MSG_NOSIGNAL | MSG_DONTWAIT | (g.data_len ? MSG_MORE : 0));
+                } else {
+                        uint64_t done = g.in_part - g.head_len;
+                        uint64_t left = g.data_len - done;
+                        if (left > *budget)
+                                left = *budget;
+
+                        /* priamo z page cache */
+                        off_t off = b->file_off + (off_t)(g.data_off + done);
+                        n = sendfile(fd, b->file_fd, &off, (size_t)left);
+                        if (n == 0)
+                                return -1; /* súbor je kratší, než sme čakali */
+                }
+
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                                *blocked = 1;
+                                return 0;
+                        }
+                        return -1;
+                }
+
+                it->pos += (uint64_t)n;
+                *budget = (uint64_t)n < *budget ? *budget - (uint64_t)n : 0;
+        }
+        return 1;
+}
+
+struct outq_client {
+        int fd;
+        int local;              /* UNIX socket, môže dostať fd */
+        size_t index;           /* pozícia v q->clients */
+        outq_item_t *head;
+        outq_item_t *tail;
+        uint64_t bytes;         /* neodoslané bajty vo fronte */
+        uint32_t items;
+        int resync;             /* vynechal delty, ďalšia musí byť celý stav */
+        int dead;               /* odstráni ho reaktor */
+        int blocked;            /* socket je plný, čaká sa na EPOLLOUT */
+        int in_ready;           /* je v zozname q->ready */
+        outq_client_t *ready_next;
+
+        /* rozčítaná správa od klienta (len reaktor, bez zámku) */
+        uint8_t *in;
+        size_t in_len;
+};
+
+static void client_push(outq_client_t *c, outq_item_t *it)
+{
+        if (c->tail)
+                c->tail->next = it;
+        else
+                c->head = it;
+        c->tail = it;
+        c->bytes += it->buf->encoded;
+        c->items++;
+}
+
+/* vyberie odoslanú položku zo začiatku frontu */
+static void client_pop(outq_client_t *c)
+{
+        outq_item_t *it = c->head;
+        c->head = it->next;
+        if (!c->head)
+                c->tail = NULL;
+        c->items--;
+        item_free(it);
+}
+
+/* zahodí čakajúce prenosy triedy cls (rozposlaný už musí dobehnúť celý) */
+static void client_drop_class(outq_client_t *c, outq_class_t cls)
+{
+        outq_item_t **pp = &c->head;
+        c->tail = NULL;
+
+        while (*pp) {
+                outq_item_t *it = *pp;
+                if (it->cls == cls && it->pos == 0) {
+                        *pp = it->next;
+                        c->bytes -= it->buf->encoded;
+                        c->items--;
+                        item_free(it);
+                        continue;
+                }
+                c->tail = it;
+                pp = &it->next;
+        }
+}
+
+static void client_clear(outq_client_t *c)
+{
+        while (c->head)
+                client_pop(c);
+        c->bytes = 0;
+}
+
+/* pošle z frontu, koľko sa dá bez čakania (plný socket nastaví blocked);
+   správy v pamäti idú spolu jedným sendmsg (hlavičky, dáta aj viac malých správ za sebou) */
+static void client_flush(outq_client_t *c)
+{
+        uint64_t budget = OUTQ_BURST;
+
+        while (c->head && budget > 0) {
+                outq_item_t *it = c->head;
+
+                if (it->buf->file_fd >= 0) {
+                        uint64_t before = it->pos;
+                        int r = item_send_file(c->fd, it, &budget, &c->blocked);
+                        c->bytes -= it->pos - before;
+                        if (r < 0)
+                                c->dead = 1;
+                        if (r <= 0)
+                                return;
+                        client_pop(c);
+                        continue;
+                }
+
+                struct iovec iov[OUTQ_IOV];
+                int n = 0;
+                uint64_t bytes = 0;
+                outq_item_t *x = it;
+                for (; x && n < OUTQ_IOV && bytes < budget; x = x->next) {
+                        /* fd ide s prvým bajtom správy, tá preto začína vlastný sendmsg */
+                        if (x->buf->file_fd >= 0 || (x != it && x->buf->pass_fd >= 0))
+                                break;
+                        uint64_t before = bytes;
+                        n += buf_iov(x->buf, x->pos, iov + n, OUTQ_IOV - n, &bytes);
+                        if (x->pos + (bytes - before) < x->buf->encoded)
+                                break;
+                }
+
+                /* MSG_MORE: za touto dávkou hneď ide ďalšia */
+                struct msghdr mh;
+                memset(&mh, 0, sizeof(mh));
+                mh.msg_iov = iov;
+                mh.msg_iovlen = (size_t)n;
+
+                union {
+                        struct cmsghdr align;
+                        char buf[CMSG_SPACE(sizeof(int))];
+                } ctl;
+                if (it->buf->pass_fd >= 0 && it->pos == 0 && c->local) {
+                        memset(&ctl, 0, sizeof(ctl));
+                        mh.msg_control = ctl.buf;
+                        mh.msg_controllen = sizeof(ctl.buf);
+                        struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+                        cm->cmsg_level = SOL_SOCKET;
+                        cm->cmsg_type = SCM_RIGHTS;
+                        cm->cmsg_len = CMSG_LEN(sizeof(int));
+                        memcpy(CMSG_DATA(cm), &it->buf->pass_fd, sizeof(int));
+                }
+
+                ssize_t sent = sendmsg(c->fd, &mh, MSG_NOSIGNAL | MSG_DONTWAIT | (x ? MSG_MORE : 0));
+                if (sent < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        if (errno == EAGAIN || errno == EWOULDBLOCK)
+                                c->blocked = 1;
+                        else
+                                c->dead = 1;
+                        return;
+                }
+
+                uint64_t left = (uint64_t)sent;
+                c->bytes -= left;
+                budget = left < budget ? budget - left : 0;
+                while (left > 0) {
+                        outq_item_t *h = c->head;
+                        uint64_t rest = h->buf->encoded - h->pos;
+                        if (left < rest) {
+                                h->pos += left;
+                                break;
+                        }
+                        left -= rest;
+                        client_pop(c);
+                }
+        }
+}
+
+static int client_lagging(const outq_t *q, const outq_client_t *c)
+{
+        return c->bytes > q->limit || c->items > OUTQ_MAX_ITEMS;
+}
+
+/* zaradí klienta, aby ho reaktor obslúžil (pod zámkom) */
+static void ready_push(outq_t *q, outq_client_t *c)
+{
+        if (c->in_ready)
+                return;
+        c->in_ready = 1;
+        c->ready_next = q->ready;
+        q->ready = c;
+}
+
+/* zobudí reaktor */
+static void outq_wake(outq_t *q)
+{
+        uint64_t one = 1;
+        ssize_t r = write(q->wake_fd, &one, sizeof(one));
+        (void)r;
+}
+
+/* patrí klient do skupiny fd < 0 (OUTQ_ALL, OUTQ_REMOTE, OUTQ_LOCAL) */
+static int target_match(int fd, const outq_client_t *c)
+{
+        if (fd == OUTQ_REMOTE)
+                return !c->local;
+        if (fd == OUTQ_LOCAL)
+                return c->local;
+        return 1;
+}
+
+static outq_client_t *client_by_fd(const outq_t *q, int fd)
+{
+        if (fd < 0 || (size_t)fd >= q->by_fd_cap)
+                return NULL;
+        return q->by_fd[fd];
+}
+
+/* pridá prijatého klienta do tabuliek (0 ok, -1 chyba pamäte) */
+static int client_add(outq_t *q, outq_client_t *c)
+{
+        if (q->count == q->cap) {
+                size_t cap = q->cap ? q->cap * 2 : 64;
+                outq_client_t **t = realloc(q->clients, cap * sizeof(*t));
+                if (!t)
+                        return -1;
+                q->clients = t;
+                q->cap = cap;
+        }
+        if ((size_t)c->fd >= q->by_fd_cap) {
+                size_t cap = q->by_fd_cap ? q->by_fd_cap : 64;
+                while (cap <= (size_t)c->fd)
+                        cap *= 2;
+                outq_client_t **t = realloc(q->by_fd, cap * sizeof(*t));
+                if (!t)
+                        return -1;
+                memset(t + q->by_fd_cap, 0, (cap - q->by_fd_cap) * sizeof(*t));
+                q->by_fd = t;
+                q->by_fd_cap = cap;
+        }
+
+        c->index = q->count;
+        q->clients[q->count++] = c;
+        q->by_fd[c->fd] = c;
+        return 0;
+}
+
+/* odstráni klienta z tabuliek a zavrie ho (pod zámkom, len reaktor) */
+static void client_remove(outq_t *q, outq_client_t *c)
+{
+        outq_client_t *last = q->clients[--q->count];
+        q->clients[c->index] = last;
+        last->index = c->index;
+        q->by_fd[c->fd] = NULL;
+
+        /* close stačí, len ak socket nedrží aj iný fd (napr. zdedený vo workeri) */
+        epoll_ctl(q->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        client_clear(c);
+        free(c->in);
+        free(c);
+}
+
+/* prijme všetky čakajúce pripojenia */
+static void reactor_accept(outq_t *q, int listen_fd)
+{
+        int fd;
+        while ((fd = net_accept(listen_fd)) >= 0) {
+                outq_client_t *c = calloc(1, sizeof(*c));
+                if (!c) {
+                        close(fd);
+                        continue;
+                }
+                c->fd = fd;
+                c->local = net_is_local(fd);
+
+                pthread_mutex_lock(&q->mtx);
+                int r = client_add(q, c);
+                pthread_mutex_unlock(&q->mtx);
+
+                /* hranovo: ozve sa len pri zmene, čítanie aj posielanie ide do EAGAIN */
+                struct epoll_event ev;
+                memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                ev.data.ptr = c;
+                if (r != 0 || epoll_ctl(q->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                        pthread_mutex_lock(&q->mtx);
+                        if (r == 0)
+                                client_remove(q, c);
+                        pthread_mutex_unlock(&q->mtx);
+                        if (r != 0) {
+                                close(fd);
+                                free(c);
+                        }
+                        continue;
+                }
+
+                q->handler.on_accept(q->handler.user, fd);
+        }
+}
+
+/* prečíta od klienta, čo prišlo, a celé správy odovzdá serveru (-1 = odpojiť) */
+static int client_read(outq_t *q, outq_client_t *c)
+{
+        while (1) {
+                if (!c->in) {
+                        c->in = malloc(sizeof(msg_header_t) + OUTQ_IN_MAX);
+                        if (!c->in)
+                                return -1;
+                }
+
+                /* najprv hlavička, potom presne jej dáta */
+                size_t want = sizeof(msg_header_t);
+                msg_header_t hdr;
+                if (c->in_len >= sizeof(hdr)) {
+                        memcpy(&hdr, c->in, sizeof(hdr));
+                        if (hdr.size > OUTQ_IN_MAX)
+                                return -1;
+                        want += hdr.size;
+                }
+
+                if (c->in_len < want) {
+                        ssize_t n = recv(c->fd, c->in + c->in_len, want - c->in_len, MSG_DONTWAIT);
+                        if (n == 0)
+                                return -1;
+                        if (n < 0) {
+                                if (errno == EINTR)
+                                        continue;
+                                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                                        return 0;
+                                return -1;
+                        }
+                        c->in_len += (size_t)n;
+                        continue;
+                }
+
+                c->in_len = 0;
+                if (q->handler.on_message(q->handler.user, c->fd, &hdr, c->in + sizeof(hdr)) != 0)
+                        return -1;
+        }
+}
+
+/* vlákno reaktora: pripojenia, správy od klientov a posielanie z frontov */
+static void *reactor_thread(void *arg)
+{
+        outq_t *q = (outq_t *)arg;
+        struct epoll_event evs[OUTQ_EVENTS];
+
+        while (1) {
+                pthread_mutex_lock(&q->mtx);
+                int timeout = q->ready ? 0 : -1;
+                pthread_mutex_unlock(&q->mtx);
+
+                int n = epoll_wait(q->epfd, evs, OUTQ_EVENTS, timeout);
+                if (n < 0)
+                        n = 0;
+
+                for (int i = 0; i < n; i++) {
+                        void *ptr = evs[i].data.ptr;
+                        if (ptr == &q->wake_fd) {
+                                uint64_t v;
+                                ssize_t r = read(q->wake_fd, &v, sizeof(v));
+                                (void)r;
+                                continue;
+                        }
+                        if (ptr == &q->listen_fds[0] || ptr == &q->listen_fds[1]) {
+                                reactor_accept(q, *(int *)ptr);
+                                continue;
+                        }
+
+                        /* klientov odstraňuje len toto vlákno až po spracovaní udalostí */
+                        outq_client_t *c = (outq_client_t *)ptr;
+                        uint32_t e = evs[i].events;
+                        int dead = 0;
+                        if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                                dead = client_read(q, c) != 0 || (e & (EPOLLHUP | EPOLLERR));
+
+                        pthread_mutex_lock(&q->mtx);
+                        if (dead)
+                                c->dead = 1;
+                        if (e & EPOLLOUT)
+                                c->blocked = 0;
+                        if (c->dead || c->head)
+                                ready_push(q, c);
+                        pthread_mutex_unlock(&q->mtx);
+                }
+
+                /* posielanie: zoznam sa odoberie naraz, zámok sa pustí po každom klientovi */
+                pthread_mutex_lock(&q->mtx);
+                outq_client_t *list = q->ready;
+                q->ready = NULL;
+                pthread_mutex_unlock(&q->mtx);
+
+                while (list) {
+                        pthread_mutex_lock(&q->mtx);
+                        outq_client_t *c = list;
+                        list = c->ready_next;
+                        c->in_ready = 0;
+
+                        if (!c->dead && !c->blocked)
+                                client_flush(c);
+                        if (c->dead)
+                                client_remove(q, c);
+                        else if (c->head && !c->blocked)
+                                ready_push(q, c); /* minul budget, pokračuje v ďalšom kole */
+                        pthread_mutex_unlock(&q->mtx);
+                }
+        }
+
+        return NULL;
+}
+
+int outq_init(outq_t *q, const outq_handler_t *handler, outq_lag_t policy, uint64_t limit)
+{
+        memset(q, 0, sizeof(*q));
+        q->handler = *handler;
+        q->policy = policy;
+        q->limit = limit;
+        pthread_mutex_init(&q->mtx, NULL);
+
+        q->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (q->epfd < 0)
+                return -1;
+
+        q->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (q->wake_fd < 0) {
+                close(q->epfd);
+                return -1;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = &q->wake_fd;
+        if (epoll_ctl(q->epfd, EPOLL_CTL_ADD, q->wake_fd, &ev) != 0) {
+                close(q->wake_fd);
+                close(q->epfd);
+                return -1;
+        }
+        return 0;
+}
+
+int outq_listen(outq_t *q, int fd)
+{
+        if (q->listen_count == 2)
+                return -1;
+
+        /* neblokujúci, aby prijímanie skončilo na EAGAIN */
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        int *slot = &q->listen_fds[q->listen_count];
+        *slot = fd;
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = slot;
+        if (epoll_ctl(q->epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+                return -1;
+        q->listen_count++;
+        return 0;
+}
+
+int outq_start(outq_t *q)
+{
+        return pthread_create(&q->tid, NULL, reactor_thread, q) == 0 ? 0 : -1;
+}
+
+void outq_send(outq_t *q, int fd, outq_buf_t *b, outq_class_t cls)
+{
+        pthread_mutex_lock(&q->mtx);
+        outq_client_t *one = fd >= 0 ? client_by_fd(q, fd) : NULL;
+        size_t count = fd >= 0 ? (one != NULL) : q->count;
+        for (size_t i = 0; i < count; i++) {
+                outq_client_t *c = one ? one : q->clients[i];
+                if (c->dead || !target_match(fd, c))
+                        continue;
+                /* reaktor pošle nové dáta alebo odstráni odpojeného */
+                ready_push(q, c);
+
+                if (fd < 0 && cls != OUTQ_BULK && client_lagging(q, c)) {
+                        if (q->policy == OUTQ_LAG_DISCONNECT) {
+                                c->dead = 1;
+                                continue;
+                        }
+                        if (q->policy == OUTQ_LAG_DROP)
+                                continue;
+                        /* ostane len najnovšia správa */
+                        client_drop_class(c, cls);
+                }
+
+                outq_item_t *it = item_new(b, cls);
+                if (!it) {
+                        /* bez celého prenosu by klient mal neúplné dáta */
+                        if (cls == OUTQ_BULK)
+                                c->dead = 1;
+                        continue;
+                }
+                client_push(c, it);
+        }
+        pthread_mutex_unlock(&q->mtx);
+        outq_wake(q);
+}
+
+void outq_message(outq_t *q, int fd, msg_type_t type, outq_class_t cls, const void *payload, uint32_t size)
+{
+        outq_buf_t *b = outq_frame(type, 0, payload, size, NULL);
+        if (!b)
+                return;
+        outq_send(q, fd, b, cls);
+        outq_release(b);
+}
+
+void outq_chunked(outq_t *q, int fd, msg_type_t type, const void *data, uint64_t total,
+                  const sim_mapping_t *map)
+{
+        outq_buf_t *b = outq_frame(type, 1, data, total, map);
+        if (!b)
+                return;
+        outq_send(q, fd, b, OUTQ_BULK);
+        outq_release(b);
+}
+
+void outq_delta(outq_t *q, int fd, const void *data, uint64_t len, outq_full_fn full, void *user)
+{
+        outq_buf_t *delta = outq_frame(MSG_SUMMARY_DELTA, 1, data, len, NULL);
+        outq_buf_t *all = NULL;
+        int all_tried = 0;
+
+        pthread_mutex_lock(&q->mtx);
+        outq_client_t *one = fd >= 0 ? client_by_fd(q, fd) : NULL;
+        size_t count = fd >= 0 ? (one != NULL) : q->count;
+        for (size_t i = 0; i < count; i++) {
+                outq_client_t *c = one ? one : q->clients[i];
+                if (c->dead || !target_match(fd, c))
+                        continue;
+                /* reaktor pošle nové dáta alebo odstráni odpojeného */
+                ready_push(q, c);
+
+                outq_buf_t *b = delta;
+                if (fd < 0) {
+                        if (client_lagging(q, c)) {
+                                if (q->policy == OUTQ_LAG_DISCONNECT) {
+                                        c->dead = 1;
+                                        continue;
+                                }
+                                /* vynechaná delta: keď klient dobehne, dostane celý stav */
+                                c->resync = 1;
+                                if (q->policy == OUTQ_LAG_DROP)
+                                        continue;
+                                /* čakajúce delty nahradí jeden celý stav */
+                                client_drop_class(c, OUTQ_DELTA);
+                        }
+
+                        if (c->resync) {
+                                if (!all_tried) {
+                                        all_tried = 1;
+                                        uint64_t all_len = 0;
+                                        void *buf = full(user, &all_len);
+                                        if (buf)
+                                                all = outq_frame(MSG_SUMMARY_DELTA, 1, buf, all_len, NULL);
+                                        free(buf);
+                                }
+                                b = all;
+                        }
+                }
+
+                outq_item_t *it = b ? item_new(b, OUTQ_DELTA) : NULL;
+                if (!it) {
+                        c->resync = 1;
+                        continue;
+                }
+                c->resync = 0;
+                client_push(c, it);
+        }
+        pthread_mutex_unlock(&q->mtx);
+        outq_wake(q);
+
+        outq_release(delta);
+        outq_release(all);
+}
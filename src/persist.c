@@ -1,15 +1,229 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "persist.h"
+#include "grid.h"
+#include "bitmap.h"
+#include "numfmt.h"
+
+/* textový formát sa zapisuje cez vlastný buffer a čísla formátuje numfmt
+   (fprintf na veľkých súboroch je pomalý a závisí od locale) */
+typedef struct {
+    FILE *file;
+    size_t len;
+    int failed;
+    char buf[1 << 16];
+} text_out_t;
+
+static void out_flush(text_out_t *o)
+{
+    if (o->len > 0 && fwrite(o->buf, 1, o->len, o->file) != o->len)
+        o->failed = 1;
+    o->len = 0;
+}
+
+/* miesto aspoň na n bajtov (n je najviac pár desiatok) */
+static char *out_space(text_out_t *o, size_t n)
+{
+    if (o->len + n > sizeof(o->buf))
+        out_flush(o);
+    return o->buf + o->len;
+}
+
+static void out_char(text_out_t *o, char c)
+{
+    *out_space(o, 1) = c;
+    o->len++;
+}
+
+static void out_str(text_out_t *o, const char *str)
+{
+    for (; *str; str++)
+        out_char(o, *str);
+}
+
+static void out_u64(text_out_t *o, uint64_t v)
+{
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+
+    char *p = out_space(o, n);
+    for (size_t i = 0; i < n; i++)
+        p[i] = tmp[n - 1 - i];
+    o->len += n;
+}
+
+static void out_int(text_out_t *o, int v)
+{
+    if (v < 0) {
+        out_char(o, '-');
+        out_u64(o, (uint64_t)0 - (uint64_t)(int64_t)v);
+    } else {
+        out_u64(o, (uint64_t)v);
+    }
+}
+
+/* najkratší zápis, ktorý sa načíta na tú istú hodnotu */
+static void out_double(text_out_t *o, double v)
+{
+    o->len += numfmt_double(out_space(o, NUMFMT_DOUBLE_MAX), v);
+}
+
+/* "KĽÚČ hodnota\n" */
+static void out_key_u64(text_out_t *o, const char *key, uint64_t v)
+{
+    out_str(o, key);
+    out_char(o, ' ');
+    out_u64(o, v);
+    out_char(o, '\n');
+}
+
+static void out_key_int(text_out_t *o, const char *key, int v)
+{
+    out_str(o, key);
+    out_char(o, ' ');
+    out_int(o, v);
+    out_char(o, '\n');
+}
+
+static void out_begin(text_out_t *o, FILE *file)
+{
+    o->file = file;
+    o->len = 0;
+    o->failed = 0;
+}
+
+/* zapíše zvyšok bufferu, 0 ak všetko prešlo */
+static int out_end(text_out_t *o)
+{
+    out_flush(o);
+    return (o->failed || ferror(o->file)) ? -1 : 0;
+}
+
+/* textový súbor sa číta celý naraz (mmap) jedným prechodom kurzora */
+typedef struct {
+    const char *p;
+    const char *end;
+    void *map;
+    size_t len;
+    int mapped;     /* 0 = map je z malloc */
+} text_in_t;
+
+static int in_open(text_in_t *in, const char *path)
+{
+    memset(in, 0, sizeof(*in));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+        in->len = (size_t)st.st_size;
+        in->map = mmap(NULL, in->len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (in->map != MAP_FAILED) {
+            in->mapped = 1;
+            posix_madvise(in->map, in->len, POSIX_MADV_SEQUENTIAL);
+        } else {
+            in->map = NULL;
+        }
+    }
+
+    /* rúra, prázdny súbor a podobne: prečíta sa do pamäte */
+    if (!in->mapped) {
+        size_t cap = 1 << 16;
+        in->len = 0;
+        in->map = malloc(cap);
+        for (;;) {
+            if (!in->map) {
+                close(fd);
+                return -1;
+            }
+            ssize_t n = read(fd, (char *)in->map + in->len, cap - in->len);
+            if (n < 0) {
+                free(in->map);
+                close(fd);
+                return -1;
+            }
+            if (n == 0)
+                break;
+            in->len += (size_t)n;
+            if (in->len == cap) {
+                cap *= 2;
+                void *grown = realloc(in->map, cap);
+                if (!grown)
+                    free(in->map);
+                in->map = grown;
+            }
+        }
+    }
+
+    close(fd);
+    in->p = (const char *)in->map;
+    in->end = in->p + in->len;
+    return 0;
+}
+
+static void in_close(text_in_t *in)
+{
+    if (in->mapped)
+        munmap(in->map, in->len);
+    else
+        free(in->map);
+    memset(in, 0, sizeof(*in));
+}
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static void in_skip_space(text_in_t *in)
+{
+    while (in->p < in->end && is_space(*in->p))
+        in->p++;
+}
+
+/* slovo do prvej medzery, najviac 63 znakov (ako "%63s") */
+static int in_word(text_in_t *in, char key[64])
+{
+    in_skip_space(in);
+    size_t n = 0;
+    while (in->p < in->end && !is_space(*in->p) && n < 63)
+        key[n++] = *in->p++;
+    key[n] = '\0';
+    return n > 0 ? 0 : -1;
+}
+
+/* preskočí zvyšok riadku aj s '\n' */
+static void in_skip_line(text_in_t *in)
+{
+    const char *nl = memchr(in->p, '\n', (size_t)(in->end - in->p));
+    in->p = nl ? nl + 1 : in->end;
+}
 
 /* očakáva konkrétne kľúčové slovo v súbore - Odporúčené AI */
-static int expect_word(FILE *file, const char *word)
+static int expect_word(text_in_t *in, const char *word)
 {
     char buffer[64];
 
-    if (fscanf(file, "%63s", buffer) != 1)
+    if (in_word(in, buffer) != 0)
         return -1;
 
     if (strcmp(buffer, word) != 0)
@@ -18,164 +232,1264 @@ static int expect_word(FILE *file, const char *word)
     return 0;
 }
 
-/* uloží konfiguráciu, prekážky a výsledky do súboru */
-int save_simulation(const char *path,
-                    const config *cfg,
-                    const uint8_t *obstacles,
-                    const msg_sum_cell_t *summary_cells)
+/* celé číslo bez znamienka (pretečenie = chyba) */
+static int in_u64(text_in_t *in, uint64_t *v)
 {
-    if (!path || !cfg || !summary_cells)
+    in_skip_space(in);
+    if (in->p < in->end && *in->p == '+')
+        in->p++;
+    if (in->p >= in->end || *in->p < '0' || *in->p > '9')
         return -1;
 
-    FILE *file = fopen(path, "w");
-    if (!file)
+    uint64_t x = 0;
+    for (; in->p < in->end && *in->p >= '0' && *in->p <= '9'; in->p++) {
+        unsigned d = (unsigned)(*in->p - '0');
+        if (x > (UINT64_MAX - d) / 10)
+            return -1;
+        x = x * 10 + d;
+    }
+    *v = x;
+    return 0;
+}
+
+static int in_u32(text_in_t *in, uint32_t *v)
+{
+    uint64_t x;
+    if (in_u64(in, &x) != 0 || x > UINT32_MAX)
         return -1;
+    *v = (uint32_t)x;
+    return 0;
+}
 
-    fprintf(file, "WIDTH %d\n", cfg->world_width);
-    fprintf(file, "HEIGHT %d\n", cfg->world_height);
-    fprintf(file, "REPLICATIONS %u\n", (unsigned)cfg->replications);
-    fprintf(file, "MAX_STEPS %u\n", (unsigned)cfg->max_steps);
+static int in_int(text_in_t *in, int *v)
+{
+    in_skip_space(in);
+    int neg = 0;
+    if (in->p < in->end && *in->p == '-') {
+        neg = 1;
+        in->p++;
+    }
 
-    fprintf(file, "PROBS %.17g %.17g %.17g %.17g\n",
-            cfg->probs.p_up,
-            cfg->probs.p_down,
-            cfg->probs.p_left,
-            cfg->probs.p_right);
+    uint64_t x;
+    if (in_u64(in, &x) != 0 || x > (uint64_t)INT32_MAX + (uint64_t)neg)
+        return -1;
+    *v = neg ? (int)(0 - (int64_t)x) : (int)x;
+    return 0;
+}
 
-    fprintf(file, "WORLD_TYPE %d\n", (int)cfg->world_type);
-    fprintf(file, "OBSTACLE_DENSITY %.17g\n", cfg->obstacle_density);
+static int in_double(text_in_t *in, double *v)
+{
+    in_skip_space(in);
+    const char *next = numfmt_parse_double(in->p, in->end, v);
+    if (!next)
+        return -1;
+    in->p = next;
+    return 0;
+}
 
+/* prekážky ako bitová mapa: riadok sveta = hex číslice po 4 políčkach (prvé políčko je najvyšší bit);
+   príznak 0 = prázdny svet bez riadkov */
+static void save_obstacle_bits(text_out_t *o, const config *cfg, const uint64_t *obstacles)
+{
     int width = cfg->world_width;
     int height = cfg->world_height;
 
-    fprintf(file, "OBSTACLES\n");
+    if (cfg->world_type != WORLD_OBSTACLES || !obstacles) {
+        out_str(o, "OBSTACLES_BITS 0\n");
+        return;
+    }
+
+    out_str(o, "OBSTACLES_BITS 1\n");
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int value = 0;
+        for (int x = 0; x < width; x += 4) {
+            unsigned digit = 0;
+            for (int k = 0; k < 4; k++) {
+                digit <<= 1;
+                if (x + k < width && bitmap_get(obstacles, (size_t)y * width + (size_t)(x + k)))
+                    digit |= 1u;
+            }
+            out_char(o, "0123456789abcdef"[digit]);
+        }
+        out_char(o, '\n');
+    }
+}
 
-            if (cfg->world_type == WORLD_OBSTACLES && obstacles)
-                value = obstacles[y * width + x] ? 1 : 0;
+/* načíta OBSTACLES_BITS (kľúčové slovo už je prečítané) */
+static int load_obstacle_bits(text_in_t *in, int width, int height, uint64_t **obstacles_out)
+{
+    int flag = 0;
+    if (in_int(in, &flag) != 0)
+        return -1;
+    if (flag == 0)
+        return 0;
 
-            fprintf(file, "%d", value);
+    size_t digits = ((size_t)width + 3) / 4;
+    uint64_t *obstacles = bitmap_alloc((size_t)width * (size_t)height);
+    if (!obstacles)
+        return -1;
 
-            if (x != width - 1)
-                fputc(' ', file);
+    for (int y = 0; y < height; y++) {
+        /* riadok má presne digits znakov */
+        in_skip_space(in);
+        if ((size_t)(in->end - in->p) < digits)
+            goto fail;
+        const char *row = in->p;
+        in->p += digits;
+        if (in->p < in->end && !is_space(*in->p))
+            goto fail;
+
+        for (size_t d = 0; d < digits; d++) {
+            char ch = row[d];
+            unsigned digit;
+            if (ch >= '0' && ch <= '9')
+                digit = (unsigned)(ch - '0');
+            else if (ch >= 'a' && ch <= 'f')
+                digit = (unsigned)(ch - 'a' + 10);
+            else
+                goto fail;
+
+            for (int k = 0; k < 4; k++) {
+                int x = (int)d * 4 + k;
+                if (x < width && (digit & (8u >> k)))
+                    bitmap_set(obstacles, (size_t)y * width + (size_t)x);
+            }
         }
-        fputc('\n', file);
     }
 
-    fprintf(file, "SUMMARY\n");
-    for (int i = 0; i < width * height; i++) {
-        fprintf(file, "%.17g %.17g\n",
-                summary_cells[i].avg_steps,
-                summary_cells[i].probability);
+    *obstacles_out = obstacles;
+    return 0;
+
+fail:
+    free(obstacles);
+    return -1;
+}
+
+/* starší formát: OBSTACLES a mriežka 0/1 oddelená medzerami */
+static int load_obstacle_grid(text_in_t *in, int width, int height, uint64_t **obstacles_out)
+{
+    uint64_t *obstacles = bitmap_alloc((size_t)width * (size_t)height);
+    if (!obstacles)
+        return -1;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int value = 0;
+            if (in_int(in, &value) != 0) {
+                free(obstacles);
+                return -1;
+            }
+
+            if (value != 0)
+                bitmap_set(obstacles, (size_t)y * width + (size_t)x);
+        }
     }
 
-    fclose(file);
+    *obstacles_out = obstacles;
     return 0;
 }
 
-/* načíta simuláciu zo súboru */
-int load_simulation(const char *path,
-                    config *cfg_out,
-                    uint8_t **obstacles_out,
-                    msg_sum_cell_t **summary_out)
+/* spoločná hlavička uloženej simulácie aj checkpointu */
+static void save_header(text_out_t *o, const config *cfg)
 {
-    if (!path || !cfg_out || !obstacles_out || !summary_out)
-        return -1;
+    out_key_int(o, "WIDTH", cfg->world_width);
+    out_key_int(o, "HEIGHT", cfg->world_height);
+    out_key_u64(o, "REPLICATIONS", cfg->replications);
+    out_key_u64(o, "MAX_STEPS", cfg->max_steps);
 
-    *obstacles_out = NULL;
-    *summary_out = NULL;
+    out_str(o, "PROBS ");
+    out_double(o, cfg->probs.p_up);
+    out_char(o, ' ');
+    out_double(o, cfg->probs.p_down);
+    out_char(o, ' ');
+    out_double(o, cfg->probs.p_left);
+    out_char(o, ' ');
+    out_double(o, cfg->probs.p_right);
+    out_char(o, '\n');
+
+    out_key_int(o, "WORLD_TYPE", (int)cfg->world_type);
+    out_str(o, "OBSTACLE_DENSITY ");
+    out_double(o, cfg->obstacle_density);
+    out_char(o, '\n');
+    out_key_u64(o, "SEED", cfg->seed);
+
+    /* len pri rozdelenom behu, bežné súbory ostávajú bez zmeny */
+    if (cfg->first_rep > 0)
+        out_key_u64(o, "FIRST_REP", cfg->first_rep);
+}
 
-    FILE *file = fopen(path, "r");
+/* surové počty na políčko: "zásahy súčet_krokov replikácie", dajú sa sčítať s iným behom */
+static void save_counters(text_out_t *o, size_t cells, const uint64_t *hits,
+                          const uint64_t *steps_sum, const uint32_t *reps_used)
+{
+    out_str(o, "COUNTERS\n");
+    for (size_t i = 0; i < cells; i++) {
+        out_u64(o, hits[i]);
+        out_char(o, ' ');
+        out_u64(o, steps_sum[i]);
+        out_char(o, ' ');
+        out_u64(o, reps_used[i]);
+        out_char(o, '\n');
+    }
+}
+
+/* načíta sekciu COUNTERS do pripravených polí (kľúčové slovo už je prečítané) */
+static int load_counters(text_in_t *in, size_t cells, uint64_t *hits, uint64_t *steps_sum, uint32_t *reps_used)
+{
+    for (size_t i = 0; i < cells; i++) {
+        if (in_u64(in, &hits[i]) != 0 || in_u64(in, &steps_sum[i]) != 0 || in_u32(in, &reps_used[i]) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* histogram časov príchodu: riadok na políčko, dvojice "zásahy súčet_krokov" po košoch */
+static void save_hist(text_out_t *o, const fpt_hist_t *hist)
+{
+    out_str(o, "FIRST_PASSAGE ");
+    out_u64(o, hist->width);
+    out_char(o, ' ');
+    out_u64(o, hist->buckets);
+    out_char(o, '\n');
+    for (uint32_t i = 0; i < hist->cells; i++) {
+        for (uint32_t b = 0; b < hist->buckets; b++) {
+            size_t k = (size_t)i * hist->buckets + b;
+            out_u64(o, hist->hits[k]);
+            out_char(o, ' ');
+            out_u64(o, hist->steps[k]);
+
+            if (b != hist->buckets - 1)
+                out_char(o, ' ');
+        }
+        out_char(o, '\n');
+    }
+}
+
+void summary_from_counters(const config *cfg,
+                           const uint64_t *hits,
+                           const uint64_t *steps_sum,
+                           const uint32_t *reps_used,
+                           msg_sum_cell_t *out)
+{
+    size_t cells = grid_cells(cfg);
+    size_t origin = (size_t)grid_idx_of(cfg, 0, 0);
+
+    for (size_t i = 0; i < cells; i++) {
+        if (i == origin) {
+            out[i].avg_steps = 0.0;
+            out[i].probability = 1.0;
+            continue;
+        }
+
+        /* prekážky a nedosiahnuteľné políčka nemajú zásahy, vyjde 0 */
+        out[i].probability = reps_used[i] ? (double)hits[i] / (double)reps_used[i] : 0.0;
+        out[i].avg_steps = hits[i] ? (double)steps_sum[i] / (double)hits[i] : 0.0;
+    }
+}
+
+/* textový formát: konfigurácia, prekážky a výsledky po riadkoch */
+static int save_text(const char *path,
+                     const config *cfg,
+                     const uint64_t *obstacles,
+                     const msg_sum_cell_t *summary_cells,
+                     const uint32_t *reps_used,
+                     const uint64_t *hits,
+                     const uint64_t *steps_sum,
+                     const fpt_hist_t *hist)
+{
+    FILE *file = fopen(path, "w");
     if (!file)
         return -1;
 
+    text_out_t *o = malloc(sizeof(*o));
+    if (!o) {
+        fclose(file);
+        return -1;
+    }
+    out_begin(o, file);
+
+    save_header(o, cfg);
+
+    int width = cfg->world_width;
+    int height = cfg->world_height;
+
+    save_obstacle_bits(o, cfg, obstacles);
+
+    size_t cells = (size_t)width * (size_t)height;
+
+    out_str(o, "SUMMARY\n");
+    for (size_t i = 0; i < cells; i++) {
+        out_double(o, summary_cells[i].avg_steps);
+        out_char(o, ' ');
+        out_double(o, summary_cells[i].probability);
+        out_char(o, '\n');
+    }
+
+    /* Monte Carlo beh: surové počty (obsahujú aj replikácie na políčko) */
+    if (reps_used && hits && steps_sum) {
+        save_counters(o, cells, hits, steps_sum, reps_used);
+    } else if (reps_used) {
+        /* bez počtov aspoň koľko replikácií dostalo každé políčko */
+        out_str(o, "REPLICATIONS_USED\n");
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                out_u64(o, reps_used[(size_t)y * width + (size_t)x]);
+
+                if (x != width - 1)
+                    out_char(o, ' ');
+            }
+            out_char(o, '\n');
+        }
+    }
+
+    if (hist && hist->cells == cells)
+        save_hist(o, hist);
+
+    int rc = out_end(o);
+    free(o);
+    if (fclose(file) != 0)
+        rc = -1;
+    return rc;
+}
+
+/* načíta spoločnú hlavičku (WIDTH .. SEED); key = nasledujúce kľúčové slovo */
+static int load_header(text_in_t *in, config *cfg_out, char key[64])
+{
     memset(cfg_out, 0, sizeof(*cfg_out));
 
-    if (expect_word(file, "WIDTH") != 0 ||
-        fscanf(file, "%d", &cfg_out->world_width) != 1)
-        goto fail;
+    if (expect_word(in, "WIDTH") != 0 ||
+        in_int(in, &cfg_out->world_width) != 0)
+        return -1;
 
-    if (expect_word(file, "HEIGHT") != 0 ||
-        fscanf(file, "%d", &cfg_out->world_height) != 1)
-        goto fail;
+    if (expect_word(in, "HEIGHT") != 0 ||
+        in_int(in, &cfg_out->world_height) != 0)
+        return -1;
 
-    if (expect_word(file, "REPLICATIONS") != 0 ||
-        fscanf(file, "%u", &cfg_out->replications) != 1)
-        goto fail;
+    if (expect_word(in, "REPLICATIONS") != 0 ||
+        in_u32(in, &cfg_out->replications) != 0)
+        return -1;
 
-    if (expect_word(file, "MAX_STEPS") != 0 ||
-        fscanf(file, "%u", &cfg_out->max_steps) != 1)
-        goto fail;
+    if (expect_word(in, "MAX_STEPS") != 0 ||
+        in_u32(in, &cfg_out->max_steps) != 0)
+        return -1;
 
-    if (expect_word(file, "PROBS") != 0 ||
-        fscanf(file, "%lf %lf %lf %lf",
-               &cfg_out->probs.p_up,
-               &cfg_out->probs.p_down,
-               &cfg_out->probs.p_left,
-               &cfg_out->probs.p_right) != 4)
-        goto fail;
+    if (expect_word(in, "PROBS") != 0 ||
+        in_double(in, &cfg_out->probs.p_up) != 0 ||
+        in_double(in, &cfg_out->probs.p_down) != 0 ||
+        in_double(in, &cfg_out->probs.p_left) != 0 ||
+        in_double(in, &cfg_out->probs.p_right) != 0)
+        return -1;
 
     int world_type = 0;
-    if (expect_word(file, "WORLD_TYPE") != 0 ||
-        fscanf(file, "%d", &world_type) != 1)
-        goto fail;
+    if (expect_word(in, "WORLD_TYPE") != 0 ||
+        in_int(in, &world_type) != 0)
+        return -1;
 
     cfg_out->world_type = (world_type_t)world_type;
 
-    if (expect_word(file, "OBSTACLE_DENSITY") != 0 ||
-        fscanf(file, "%lf", &cfg_out->obstacle_density) != 1)
-        goto fail;
+    if (expect_word(in, "OBSTACLE_DENSITY") != 0 ||
+        in_double(in, &cfg_out->obstacle_density) != 0)
+        return -1;
+
+    if (in_word(in, key) != 0)
+        return -1;
+
+    /* SEED je nepovinný, staršie súbory ho nemajú */
+    if (strcmp(key, "SEED") == 0) {
+        if (in_u64(in, &cfg_out->seed) != 0 ||
+            in_word(in, key) != 0)
+            return -1;
+    }
+
+    if (strcmp(key, "FIRST_REP") == 0) {
+        if (in_u32(in, &cfg_out->first_rep) != 0 ||
+            in_word(in, key) != 0)
+            return -1;
+    }
 
     int width = cfg_out->world_width;
     int height = cfg_out->world_height;
-    if (width <= 0 || height <= 0)
-        goto fail;
+    if (width <= 0 || height <= 0 || (uint64_t)width * (uint64_t)height > GRID_MAX_CELLS)
+        return -1;
+    return 0;
+}
 
-    uint8_t *obstacles = calloc((size_t)(width * height), 1);
-    if (!obstacles)
+/* načíta sekciu FIRST_PASSAGE (kľúčové slovo už je prečítané) */
+static int load_hist(text_in_t *in, const config *cfg, fpt_hist_t *hist)
+{
+    uint32_t width = 0, buckets = 0;
+    if (in_u32(in, &width) != 0 || in_u32(in, &buckets) != 0)
+        return -1;
+
+    uint32_t cells = (uint32_t)grid_cells(cfg);
+    uint32_t origin = (uint32_t)grid_idx_of(cfg, 0, 0);
+    if (fpt_alloc(hist, cells, origin, cfg->max_steps, width) != 0)
+        return -1;
+    if (hist->buckets != buckets)
         goto fail;
 
-    if (expect_word(file, "OBSTACLES") != 0)
-        goto fail_obstacles;
+    for (size_t k = 0; k < (size_t)cells * buckets; k++) {
+        if (in_u32(in, &hist->hits[k]) != 0 || in_u64(in, &hist->steps[k]) != 0)
+            goto fail;
+    }
+    return 0;
 
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            int value = 0;
-            if (fscanf(file, "%d", &value) != 1)
-                goto fail_obstacles;
+fail:
+    fpt_free(hist);
+    return -1;
+}
 
-            obstacles[y * width + x] = (value != 0) ? 1 : 0;
-        }
+/* načíta textový formát (polia alokuje) */
+static int load_text(const char *path,
+                     config *cfg_out,
+                     uint64_t **obstacles_out,
+                     msg_sum_cell_t **summary_out,
+                     uint32_t **reps_used_out,
+                     uint64_t **hits_out,
+                     uint64_t **steps_sum_out,
+                     fpt_hist_t *hist_out)
+{
+    text_in_t in;
+    if (in_open(&in, path) != 0)
+        return -1;
+
+    char key[64];
+    if (load_header(&in, cfg_out, key) != 0)
+        goto fail;
+
+    int width = cfg_out->world_width;
+    int height = cfg_out->world_height;
+    size_t cells = grid_cells(cfg_out);
+
+    /* prekážky: bitová mapa alebo starší formát 0/1 */
+    uint64_t *obstacles = NULL;
+    if (strcmp(key, "OBSTACLES_BITS") == 0) {
+        if (load_obstacle_bits(&in, width, height, &obstacles) != 0)
+            goto fail;
+    } else if (strcmp(key, "OBSTACLES") == 0) {
+        if (load_obstacle_grid(&in, width, height, &obstacles) != 0)
+            goto fail;
+    } else {
+        goto fail;
     }
 
-    msg_sum_cell_t *summary = calloc((size_t)(width * height), sizeof(*summary));
+    msg_sum_cell_t *summary = calloc(cells, sizeof(*summary));
     if (!summary)
         goto fail_obstacles;
 
-    if (expect_word(file, "SUMMARY") != 0)
+    if (expect_word(&in, "SUMMARY") != 0)
         goto fail_summary;
 
-    for (int i = 0; i < width * height; i++) {
-        if (fscanf(file, "%lf %lf",
-                   &summary[i].avg_steps,
-                   &summary[i].probability) != 2)
+    for (size_t i = 0; i < cells; i++) {
+        if (in_double(&in, &summary[i].avg_steps) != 0 ||
+            in_double(&in, &summary[i].probability) != 0)
             goto fail_summary;
     }
 
-    fclose(file);
+    /* nepovinné sekcie na konci: COUNTERS alebo REPLICATIONS_USED a FIRST_PASSAGE */
+    uint32_t *reps_used = NULL;
+    uint64_t *hits = NULL;
+    uint64_t *steps_sum = NULL;
+    while (in_word(&in, key) == 0) {
+        if (strcmp(key, "COUNTERS") == 0 && !reps_used) {
+            reps_used = calloc(cells, sizeof(*reps_used));
+            hits = calloc(cells, sizeof(*hits));
+            steps_sum = calloc(cells, sizeof(*steps_sum));
+            if (!reps_used || !hits || !steps_sum)
+                goto fail_reps;
+
+            if (load_counters(&in, cells, hits, steps_sum, reps_used) != 0)
+                goto fail_reps;
+        } else if (strcmp(key, "REPLICATIONS_USED") == 0 && !reps_used) {
+            reps_used = calloc(cells, sizeof(*reps_used));
+            if (!reps_used)
+                goto fail_reps;
+
+            for (size_t i = 0; i < cells; i++) {
+                if (in_u32(&in, &reps_used[i]) != 0)
+                    goto fail_reps;
+            }
+        } else if (strcmp(key, "FIRST_PASSAGE") == 0 && hist_out->cells == 0) {
+            if (load_hist(&in, cfg_out, hist_out) != 0)
+                goto fail_reps;
+        } else {
+            goto fail_reps;
+        }
+    }
+
+    /* histogram potrebuje počet replikácií každého políčka */
+    if (hist_out->cells > 0) {
+        for (size_t i = 0; i < cells; i++)
+            hist_out->reps[i] = reps_used ? reps_used[i] : cfg_out->replications;
+    }
+
+    in_close(&in);
 
     *obstacles_out = obstacles;
     *summary_out = summary;
+    *reps_used_out = reps_used;
+    *hits_out = hits;
+    *steps_sum_out = steps_sum;
     return 0;
 
+fail_reps:
+    fpt_free(hist_out);
+    free(reps_used);
+    free(hits);
+    free(steps_sum);
 fail_summary:
     free(summary);
 fail_obstacles:
     free(obstacles);
 fail:
-    fclose(file);
+    in_close(&in);
     return -1;
 }
 
+
+/* binárny formát: hlavička s configom a tabuľkou sekcií, potom surové polia
+   (little-endian, každá sekcia zarovnaná na 8 bajtov, aby sa dala použiť priamo z mmap) */
+#define SIM_BIN_MAGIC "RWSIMBIN"
+#define SIM_BIN_VERSION 1
+
+/* sekcie v poradí, v akom idú do súboru */
+enum {
+    SEC_OBSTACLES,      /* bitová mapa ako v pamäti */
+    SEC_SUMMARY,        /* msg_sum_cell_t po riadkoch */
+    SEC_REPS,           /* uint32 replikácie na políčko */
+    SEC_HITS,           /* uint64 surové zásahy */
+    SEC_STEPS,          /* uint64 súčty krokov */
+    SEC_HIST_HITS,      /* uint32 [cells * buckets] */
+    SEC_HIST_STEPS,     /* uint64 [cells * buckets] */
+    SEC_COUNT
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int32_t width;
+    int32_t height;
+    uint32_t replications;
+    uint32_t max_steps;
+    uint64_t seed;
+    uint32_t first_rep;
+    int32_t world_type;
+    double probs[4];
+    double obstacle_density;
+    uint32_t hist_width;
+    uint32_t hist_buckets;
+    uint64_t offset[SEC_COUNT];     /* od začiatku súboru, 0 = sekcia chýba */
+    uint64_t size[SEC_COUNT];       /* v bajtoch bez zarovnania */
+    uint64_t file_size;
+    uint64_t checksum;              /* nad celým súborom, toto pole počítané ako 0 */
+} sim_bin_header_t;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#define SIM_BIN_NATIVE 0
+#else
+#define SIM_BIN_NATIVE 1
+#endif
+
+static uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~(uint64_t)7;
+}
+
+/* FNV-1a po 64-bitových slovách (chvost doplnený nulami) */
+static uint64_t bin_checksum(uint64_t h, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+    if (i < len) {
+        uint64_t w = 0;
+        memcpy(&w, p + i, len - i);
+        h = (h ^ w) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#define SIM_BIN_CHECKSUM_SEED 0xcbf29ce484222325ULL
+
+/* zapíše sekciu aj s doplnením na 8 bajtov */
+static int bin_write(FILE *file, const void *data, size_t len, uint64_t *h)
+{
+    static const uint8_t zero[8];
+
+    if (len > 0 && fwrite(data, 1, len, file) != len)
+        return -1;
+    size_t pad = (size_t)(align8(len) - len);
+    if (pad > 0 && fwrite(zero, 1, pad, file) != pad)
+        return -1;
+    *h = bin_checksum(*h, data, len);
+    return 0;
+}
+
+static int save_binary(const char *path,
+                       const config *cfg,
+                       const uint64_t *obstacles,
+                       const msg_sum_cell_t *summary_cells,
+                       const uint32_t *reps_used,
+                       const uint64_t *hits,
+                       const uint64_t *steps_sum,
+                       const fpt_hist_t *hist)
+{
+    size_t cells = grid_cells(cfg);
+    int has_hist = hist && hist->cells == cells;
+    size_t hist_n = has_hist ? (size_t)hist->cells * hist->buckets : 0;
+
+    /* histogram potrebuje replikácie na políčko; bez reps_used všade cfg->replications */
+    uint32_t *reps_fill = NULL;
+    if (has_hist && !reps_used) {
+        reps_fill = malloc(cells * sizeof(uint32_t));
+        if (!reps_fill)
+            return -1;
+        for (size_t i = 0; i < cells; i++)
+            reps_fill[i] = cfg->replications;
+        reps_used = reps_fill;
+    }
+
+    sim_bin_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, SIM_BIN_MAGIC, sizeof(hdr.magic));
+    hdr.version = SIM_BIN_VERSION;
+    hdr.header_size = sizeof(hdr);
+    hdr.width = cfg->world_width;
+    hdr.height = cfg->world_height;
+    hdr.replications = cfg->replications;
+    hdr.max_steps = cfg->max_steps;
+    hdr.seed = cfg->seed;
+    hdr.first_rep = cfg->first_rep;
+    hdr.world_type = (int32_t)cfg->world_type;
+    hdr.probs[0] = cfg->probs.p_up;
+    hdr.probs[1] = cfg->probs.p_down;
+    hdr.probs[2] = cfg->probs.p_left;
+    hdr.probs[3] = cfg->probs.p_right;
+    hdr.obstacle_density = cfg->obstacle_density;
+    if (has_hist) {
+        hdr.hist_width = hist->width;
+        hdr.hist_buckets = hist->buckets;
+    }
+
+    const void *data[SEC_COUNT] = {
+        (cfg->world_type == WORLD_OBSTACLES) ? obstacles : NULL,
+        summary_cells,
+        reps_used,
+        (reps_used && hits && steps_sum) ? hits : NULL,
+        (reps_used && hits && steps_sum) ? steps_sum : NULL,
+        has_hist ? hist->hits : NULL,
+        has_hist ? hist->steps : NULL,
+    };
+    const uint64_t sizes[SEC_COUNT] = {
+        bitmap_bytes(cells),
+        cells * sizeof(msg_sum_cell_t),
+        cells * sizeof(uint32_t),
+        cells * sizeof(uint64_t),
+        cells * sizeof(uint64_t),
+        hist_n * sizeof(uint32_t),
+        hist_n * sizeof(uint64_t),
+    };
+
+    uint64_t off = align8(sizeof(hdr));
+    for (int k = 0; k < SEC_COUNT; k++) {
+        if (!data[k])
+            continue;
+        hdr.offset[k] = off;
+        hdr.size[k] = sizes[k];
+        off += align8(sizes[k]);
+    }
+    hdr.file_size = off;
+
+    /* nový súbor vznikne vedľa a nahradí starý cez rename, takže súbor, ktorý má niekto
+       namapovaný (aj load a save na tú istú cestu), ostane nedotknutý */
+    char tmp[300];
+    if ((size_t)snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= sizeof(tmp)) {
+        free(reps_fill);
+        return -1;
+    }
+
+    FILE *file = fopen(tmp, "wb");
+    if (!file) {
+        free(reps_fill);
+        return -1;
+    }
+
+    uint64_t h = SIM_BIN_CHECKSUM_SEED;
+    int ok = bin_write(file, &hdr, sizeof(hdr), &h) == 0;
+    for (int k = 0; ok && k < SEC_COUNT; k++)
+        if (data[k])
+            ok = bin_write(file, data[k], (size_t)sizes[k], &h) == 0;
+
+    /* checksum sa dopíše do hlavičky na konci */
+    hdr.checksum = h;
+    if (ok)
+        ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(&hdr, sizeof(hdr), 1, file) == 1;
+    if (fclose(file) != 0)
+        ok = 0;
+
+    free(reps_fill);
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+/* prípona .txt = textový formát, inak binárny */
+static int wants_text(const char *path)
+{
+    size_t len = strlen(path);
+    return len >= 4 && strcmp(path + len - 4, ".txt") == 0;
+}
+
+/* uloží konfiguráciu, prekážky a výsledky do súboru */
+int save_simulation(const char *path,
+                    const config *cfg,
+                    const uint64_t *obstacles,
+                    const msg_sum_cell_t *summary_cells,
+                    const uint32_t *reps_used,
+                    const uint64_t *hits,
+                    const uint64_t *steps_sum,
+                    const fpt_hist_t *hist)
+{
+    if (!path || !cfg || !summary_cells)
+        return -1;
+
+    if (!SIM_BIN_NATIVE || wants_text(path))
+        return save_text(path, cfg, obstacles, summary_cells, reps_used, hits, steps_sum, hist);
+    return save_binary(path, cfg, obstacles, summary_cells, reps_used, hits, steps_sum, hist);
+}
+
+/* skontroluje namapovaný súbor: hlavička, sekcie v rámci súboru a checksum */
+static int bin_check(const uint8_t *base, size_t len, sim_bin_header_t *hdr)
+{
+    if (len < sizeof(*hdr))
+        return -1;
+    memcpy(hdr, base, sizeof(*hdr));
+
+    if (memcmp(hdr->magic, SIM_BIN_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->version != SIM_BIN_VERSION || hdr->header_size != sizeof(*hdr) || hdr->file_size != len)
+        return -1;
+
+    if (hdr->width <= 0 || hdr->height <= 0 ||
+        (uint64_t)hdr->width * (uint64_t)hdr->height > GRID_MAX_CELLS)
+        return -1;
+
+    if (hdr->offset[SEC_HIST_HITS] != 0 &&
+        (hdr->hist_width == 0 || hdr->hist_buckets != (hdr->max_steps + hdr->hist_width - 1) / hdr->hist_width))
+        return -1;
+
+    uint64_t cells = (uint64_t)hdr->width * (uint64_t)hdr->height;
+    uint64_t hist_n = cells * hdr->hist_buckets;
+    const uint64_t sizes[SEC_COUNT] = {
+        bitmap_bytes(cells),
+        cells * sizeof(msg_sum_cell_t),
+        cells * sizeof(uint32_t),
+        cells * sizeof(uint64_t),
+        cells * sizeof(uint64_t),
+        hist_n * sizeof(uint32_t),
+        hist_n * sizeof(uint64_t),
+    };
+
+    for (int k = 0; k < SEC_COUNT; k++) {
+        if (hdr->offset[k] == 0)
+            continue;
+        if (hdr->size[k] != sizes[k] || hdr->offset[k] % 8 != 0 ||
+            hdr->offset[k] < sizeof(*hdr) || hdr->offset[k] > len || len - hdr->offset[k] < sizes[k])
+            return -1;
+    }
+
+    /* summary je povinné, surové počty len spolu, histogram len s replikáciami */
+    if (hdr->offset[SEC_SUMMARY] == 0 ||
+        (hdr->offset[SEC_HITS] == 0) != (hdr->offset[SEC_STEPS] == 0) ||
+        (hdr->offset[SEC_HITS] != 0 && hdr->offset[SEC_REPS] == 0) ||
+        (hdr->offset[SEC_HIST_HITS] == 0) != (hdr->offset[SEC_HIST_STEPS] == 0) ||
+        (hdr->offset[SEC_HIST_HITS] != 0 && hdr->offset[SEC_REPS] == 0))
+        return -1;
+
+    sim_bin_header_t zeroed = *hdr;
+    zeroed.checksum = 0;
+    uint64_t h = bin_checksum(SIM_BIN_CHECKSUM_SEED, &zeroed, sizeof(zeroed));
+    for (int k = 0; k < SEC_COUNT; k++)
+        if (hdr->offset[k] != 0)
+            h = bin_checksum(h, base + hdr->offset[k], (size_t)hdr->size[k]);
+    return h == hdr->checksum ? 0 : -1;
+}
+
+/* kópia sekcie do malloc (pri načítaní bez mapovania) */
+static void *bin_copy(const uint8_t *base, const sim_bin_header_t *hdr, int k, int *failed)
+{
+    if (hdr->offset[k] == 0)
+        return NULL;
+    void *p = malloc((size_t)hdr->size[k]);
+    if (!p) {
+        *failed = 1;
+        return NULL;
+    }
+    memcpy(p, base + hdr->offset[k], (size_t)hdr->size[k]);
+    return p;
+}
+
+/* načíta binárny súbor cez mmap; s map_out polia ukazujú do mapovania (MAP_PRIVATE,
+   takže sa dajú aj meniť bez zásahu do súboru), bez neho sa skopírujú */
+static int load_binary(int fd,
+                       config *cfg_out,
+                       uint64_t **obstacles_out,
+                       msg_sum_cell_t **summary_out,
+                       uint32_t **reps_used_out,
+                       uint64_t **hits_out,
+                       uint64_t **steps_sum_out,
+                       fpt_hist_t *hist_out,
+                       sim_mapping_t *map_out)
+{
+    struct stat st;
+    if (!SIM_BIN_NATIVE || fstat(fd, &st) != 0 || st.st_size <= 0)
+        return -1;
+
+    size_t len = (size_t)st.st_size;
+    void *base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED)
+        return -1;
+
+    const uint8_t *b = (const uint8_t *)base;
+    sim_bin_header_t hdr;
+    if (bin_check(b, len, &hdr) != 0) {
+        munmap(base, len);
+        return -1;
+    }
+
+    memset(cfg_out, 0, sizeof(*cfg_out));
+    cfg_out->world_width = hdr.width;
+    cfg_out->world_height = hdr.height;
+    cfg_out->replications = hdr.replications;
+    cfg_out->max_steps = hdr.max_steps;
+    cfg_out->seed = hdr.seed;
+    cfg_out->first_rep = hdr.first_rep;
+    cfg_out->world_type = (world_type_t)hdr.world_type;
+    cfg_out->probs.p_up = hdr.probs[0];
+    cfg_out->probs.p_down = hdr.probs[1];
+    cfg_out->probs.p_left = hdr.probs[2];
+    cfg_out->probs.p_right = hdr.probs[3];
+    cfg_out->obstacle_density = hdr.obstacle_density;
+
+    void *sec[SEC_COUNT];
+    int failed = 0;
+    for (int k = 0; k < SEC_COUNT; k++) {
+        if (map_out)
+            sec[k] = hdr.offset[k] ? (uint8_t *)base + hdr.offset[k] : NULL;
+        else
+            sec[k] = bin_copy(b, &hdr, k, &failed);
+    }
+
+    if (failed) {
+        for (int k = 0; k < SEC_COUNT; k++)
+            free(sec[k]);
+        munmap(base, len);
+        return -1;
+    }
+
+    *obstacles_out = sec[SEC_OBSTACLES];
+    *summary_out = sec[SEC_SUMMARY];
+    *reps_used_out = sec[SEC_REPS];
+    *hits_out = sec[SEC_HITS];
+    *steps_sum_out = sec[SEC_STEPS];
+
+    /* histogram: replikácie na políčko sú tie isté ako reps_used */
+    if (sec[SEC_HIST_HITS]) {
+        hist_out->width = hdr.hist_width;
+        hist_out->buckets = hdr.hist_buckets;
+        hist_out->cells = (uint32_t)grid_cells(cfg_out);
+        hist_out->max_steps = hdr.max_steps;
+        hist_out->origin = (uint32_t)grid_idx_of(cfg_out, 0, 0);
+        hist_out->hits = sec[SEC_HIST_HITS];
+        hist_out->steps = sec[SEC_HIST_STEPS];
+        if (map_out) {
+            hist_out->reps = sec[SEC_REPS];
+        } else {
+            hist_out->reps = malloc((size_t)hdr.size[SEC_REPS]);
+            if (!hist_out->reps) {
+                for (int k = 0; k < SEC_COUNT; k++)
+                    free(sec[k]);
+                memset(hist_out, 0, sizeof(*hist_out));
+                munmap(base, len);
+                return -1;
+            }
+            memcpy(hist_out->reps, sec[SEC_REPS], (size_t)hdr.size[SEC_REPS]);
+        }
+    }
+
+    if (map_out) {
+        map_out->base = base;
+        map_out->len = len;
+        map_out->fd = fd;
+    } else {
+        munmap(base, len);
+    }
+    return 0;
+}
+
+/* načíta simuláciu zo súboru (binárny alebo textový formát podľa začiatku súboru) */
+int load_simulation(const char *path,
+                    config *cfg_out,
+                    uint64_t **obstacles_out,
+                    msg_sum_cell_t **summary_out,
+                    uint32_t **reps_used_out,
+                    uint64_t **hits_out,
+                    uint64_t **steps_sum_out,
+                    fpt_hist_t *hist_out,
+                    sim_mapping_t *map_out)
+{
+    if (!path || !cfg_out || !obstacles_out || !summary_out || !reps_used_out ||
+        !hits_out || !steps_sum_out || !hist_out)
+        return -1;
+
+    *obstacles_out = NULL;
+    *summary_out = NULL;
+    *reps_used_out = NULL;
+    *hits_out = NULL;
+    *steps_sum_out = NULL;
+    memset(hist_out, 0, sizeof(*hist_out));
+    if (map_out)
+        memset(map_out, 0, sizeof(*map_out));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    char magic[8];
+    int binary = read(fd, magic, sizeof(magic)) == (ssize_t)sizeof(magic) &&
+                 memcmp(magic, SIM_BIN_MAGIC, sizeof(magic)) == 0;
+
+    int rc;
+    if (binary)
+        rc = load_binary(fd, cfg_out, obstacles_out, summary_out, reps_used_out,
+                         hits_out, steps_sum_out, hist_out, map_out);
+    else
+        rc = load_text(path, cfg_out, obstacles_out, summary_out, reps_used_out,
+                       hits_out, steps_sum_out, hist_out);
+
+    /* namapovaný súbor si nechá otvorený deskriptor (sendfile) */
+    if (!(map_out && map_out->base))
+        close(fd);
+    return rc;
+}
+
+void unmap_simulation(sim_mapping_t *map)
+{
+    if (map->base) {
+        munmap(map->base, map->len);
+        close(map->fd);
+    }
+    memset(map, 0, sizeof(*map));
+}
+
+int simulation_size(const char *path, int *w_out, int *h_out)
+{
+    text_in_t in;
+    if (in_open(&in, path) != 0)
+        return -1;
+
+    sim_bin_header_t hdr;
+    int w = 0, h = 0;
+
+    if (in.len >= sizeof(hdr) && memcmp(in.p, SIM_BIN_MAGIC, sizeof(hdr.magic)) == 0) {
+        memcpy(&hdr, in.p, sizeof(hdr));
+        w = hdr.width;
+        h = hdr.height;
+    } else {
+        /* text: stačí pár riadkov, hľadáme len WIDTH a HEIGHT */
+        char key[64];
+        for (int i = 0; i < 32; i++) {
+            if (in_word(&in, key) != 0)
+                break;
+
+            if (strcmp(key, "WIDTH") == 0) {
+                if (in_int(&in, &w) != 0)
+                    break;
+            } else if (strcmp(key, "HEIGHT") == 0) {
+                if (in_int(&in, &h) != 0)
+                    break;
+            } else {
+                in_skip_line(&in);
+            }
+
+            if (w > 0 && h > 0)
+                break;
+        }
+    }
+
+    in_close(&in);
+
+    if (w <= 0 || h <= 0)
+        return -1;
+
+    *w_out = w;
+    *h_out = h;
+    return 0;
+}
+
+/* cesta na zvyšok riadku (môže mať medzery), prázdna sa zapíše ako "-" */
+static void save_path(text_out_t *o, const char *key, const char *path)
+{
+    out_str(o, key);
+    out_char(o, ' ');
+    out_str(o, path[0] ? path : "-");
+    out_char(o, '\n');
+}
+
+/* načíta zvyšok riadku ako cestu (kľúčové slovo už je prečítané) */
+static int load_path(text_in_t *in, char *out, size_t n)
+{
+    while (in->p < in->end && *in->p == ' ')
+        in->p++;
+
+    const char *start = in->p;
+    in_skip_line(in);
+
+    size_t len = (size_t)(in->p - start);
+    while (len > 0 && (start[len - 1] == '\n' || start[len - 1] == '\r'))
+        len--;
+    if (len >= n)
+        return -1;
+
+    if (len == 1 && start[0] == '-')
+        len = 0;
+    memcpy(out, start, len);
+    out[len] = '\0';
+    return 0;
+}
+
+int save_checkpoint(const char *path, const checkpoint_t *ck)
+{
+    if (!path || !ck || !ck->state.hits || !ck->state.steps_sum || !ck->state.reps_used)
+        return -1;
+
+    char tmp[300];
+    if ((size_t)snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= sizeof(tmp))
+        return -1;
+
+    text_out_t *o = malloc(sizeof(*o));
+    if (!o)
+        return -1;
+
+    FILE *file = fopen(tmp, "w");
+    if (!file) {
+        free(o);
+        return -1;
+    }
+    out_begin(o, file);
+
+    const config *cfg = &ck->cfg;
+    const engine_state_t *st = &ck->state;
+    size_t cells = grid_cells(cfg);
+
+    out_str(o, "CHECKPOINT 1\n");
+    save_header(o, cfg);
+
+    /* zvyšok configu, od ktorého závisí pokračovanie */
+    out_key_int(o, "MODE", (int)cfg->mode);
+    out_key_int(o, "THREADS", cfg->threads);
+    out_str(o, "ADAPTIVE ");
+    out_int(o, cfg->adaptive);
+    out_char(o, ' ');
+    out_double(o, cfg->ci_tolerance);
+    out_char(o, '\n');
+    out_key_u64(o, "DEADLINE", cfg->deadline_sec);
+    out_key_int(o, "JUMP", cfg->jump);
+    out_key_u64(o, "HIST_WIDTH", cfg->hist_width);
+    out_key_int(o, "LAYOUT", cfg->layout);
+    out_str(o, "SNAPSHOT ");
+    out_u64(o, cfg->snapshot_reps);
+    out_char(o, ' ');
+    out_u64(o, cfg->snapshot_ms);
+    out_char(o, '\n');
+    out_key_u64(o, "CHECKPOINT_EVERY", cfg->checkpoint_sec);
+    save_path(o, "CHECKPOINT_FILE", cfg->checkpoint_file);
+    save_path(o, "OUTPUT_FILE", cfg->output_file);
+
+    save_obstacle_bits(o, cfg, ck->obstacles);
+
+    /* prúdy chodcov sa odvodzujú zo SEED, replikácie a políčka, takže REPS_DONE je celý stav RNG */
+    out_key_u64(o, "REPS_DONE", st->reps_done);
+
+    save_counters(o, cells, st->hits, st->steps_sum, st->reps_used);
+
+    if (st->welford && st->retired) {
+        out_str(o, "WELFORD\n");
+        for (size_t i = 0; i < cells; i++) {
+            const double *w = &st->welford[4 * i];
+            for (int k = 0; k < 4; k++) {
+                out_double(o, w[k]);
+                out_char(o, ' ');
+            }
+            out_u64(o, st->retired[i]);
+            out_char(o, '\n');
+        }
+    }
+
+    if (ck->hist.cells == cells)
+        save_hist(o, &ck->hist);
+
+    out_str(o, "END\n");
+
+    /* na disku musí byť celý súbor skôr, ako nahradí starý checkpoint */
+    int ok = out_end(o) == 0 && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    free(o);
+    if (fclose(file) != 0)
+        ok = 0;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int load_checkpoint(const char *path, checkpoint_t *ck)
+{
+    if (!path || !ck)
+        return -1;
+
+    memset(ck, 0, sizeof(*ck));
+
+    text_in_t in;
+    if (in_open(&in, path) != 0)
+        return -1;
+
+    config *cfg = &ck->cfg;
+    engine_state_t *st = &ck->state;
+    char key[64];
+    int version = 0;
+
+    if (expect_word(&in, "CHECKPOINT") != 0 || in_int(&in, &version) != 0 || version != 1)
+        goto fail;
+    if (load_header(&in, cfg, key) != 0)
+        goto fail;
+
+    cfg->start_type = SIM_NEW;
+    cfg->mode = SIM_MODE_SUMMARY;
+
+    /* kľúče configu až po prekážky */
+    while (strcmp(key, "OBSTACLES_BITS") != 0) {
+        int mode = 0;
+
+        if (strcmp(key, "MODE") == 0) {
+            if (in_int(&in, &mode) != 0)
+                goto fail;
+            cfg->mode = (sim_mode_t)mode;
+        } else if (strcmp(key, "THREADS") == 0) {
+            if (in_int(&in, &cfg->threads) != 0)
+                goto fail;
+        } else if (strcmp(key, "ADAPTIVE") == 0) {
+            if (in_int(&in, &cfg->adaptive) != 0 || in_double(&in, &cfg->ci_tolerance) != 0)
+                goto fail;
+        } else if (strcmp(key, "DEADLINE") == 0) {
+            if (in_u32(&in, &cfg->deadline_sec) != 0)
+                goto fail;
+        } else if (strcmp(key, "JUMP") == 0) {
+            if (in_int(&in, &cfg->jump) != 0)
+                goto fail;
+        } else if (strcmp(key, "HIST_WIDTH") == 0) {
+            if (in_u32(&in, &cfg->hist_width) != 0)
+                goto fail;
+        } else if (strcmp(key, "LAYOUT") == 0) {
+            if (in_int(&in, &cfg->layout) != 0)
+                goto fail;
+        } else if (strcmp(key, "SNAPSHOT") == 0) {
+            if (in_u32(&in, &cfg->snapshot_reps) != 0 || in_u32(&in, &cfg->snapshot_ms) != 0)
+                goto fail;
+        } else if (strcmp(key, "CHECKPOINT_EVERY") == 0) {
+            if (in_u32(&in, &cfg->checkpoint_sec) != 0)
+                goto fail;
+        } else if (strcmp(key, "CHECKPOINT_FILE") == 0) {
+            if (load_path(&in, cfg->checkpoint_file, sizeof(cfg->checkpoint_file)) != 0)
+                goto fail;
+        } else if (strcmp(key, "OUTPUT_FILE") == 0) {
+            if (load_path(&in, cfg->output_file, sizeof(cfg->output_file)) != 0)
+                goto fail;
+        } else {
+            goto fail;
+        }
+
+        if (in_word(&in, key) != 0)
+            goto fail;
+    }
+
+    if (load_obstacle_bits(&in, cfg->world_width, cfg->world_height, &ck->obstacles) != 0)
+        goto fail;
+
+    uint32_t reps_done = 0;
+    if (expect_word(&in, "REPS_DONE") != 0 || in_u32(&in, &reps_done) != 0 ||
+        reps_done > cfg->replications)
+        goto fail;
+    st->reps_done = reps_done;
+
+    size_t cells = grid_cells(cfg);
+    st->hits = malloc(cells * sizeof(uint64_t));
+    st->steps_sum = malloc(cells * sizeof(uint64_t));
+    st->reps_used = malloc(cells * sizeof(uint32_t));
+    if (!st->hits || !st->steps_sum || !st->reps_used)
+        goto fail;
+
+    if (expect_word(&in, "COUNTERS") != 0 ||
+        load_counters(&in, cells, st->hits, st->steps_sum, st->reps_used) != 0)
+        goto fail;
+
+    /* nepovinné sekcie: WELFORD (adaptívny režim) a FIRST_PASSAGE, na konci END */
+    for (;;) {
+        if (in_word(&in, key) != 0)
+            goto fail;
+
+        if (strcmp(key, "END") == 0) {
+            break;
+        } else if (strcmp(key, "WELFORD") == 0 && !st->welford) {
+            st->welford = malloc(cells * 4 * sizeof(double));
+            st->retired = malloc(cells);
+            if (!st->welford || !st->retired)
+                goto fail;
+
+            for (size_t i = 0; i < cells; i++) {
+                double *w = &st->welford[4 * i];
+                uint32_t retired = 0;
+                if (in_double(&in, &w[0]) != 0 || in_double(&in, &w[1]) != 0 ||
+                    in_double(&in, &w[2]) != 0 || in_double(&in, &w[3]) != 0 ||
+                    in_u32(&in, &retired) != 0)
+                    goto fail;
+                st->retired[i] = retired != 0;
+            }
+        } else if (strcmp(key, "FIRST_PASSAGE") == 0 && ck->hist.cells == 0) {
+            if (load_hist(&in, cfg, &ck->hist) != 0)
+                goto fail;
+        } else {
+            goto fail;
+        }
+    }
+
+    /* adaptívny režim bez Welfordových odhadov sa nedá presne dopočítať */
+    if (cfg->adaptive && !st->welford)
+        goto fail;
+
+    in_close(&in);
+    return 0;
+
+fail:
+    in_close(&in);
+    checkpoint_free(ck);
+    return -1;
+}
+
+void checkpoint_free(checkpoint_t *ck)
+{
+    free(ck->obstacles);
+    free(ck->state.hits);
+    free(ck->state.steps_sum);
+    free(ck->state.reps_used);
+    free(ck->state.welford);
+    free(ck->state.retired);
+    fpt_free(&ck->hist);
+    memset(ck, 0, sizeof(*ck));
+}
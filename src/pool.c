@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "pool.h"
+
+/* rozsah úloh jedného vlákna: vlastník berie zo začiatku, zlodej z konca */
+typedef struct {
+        pthread_mutex_t mtx;
+        uint64_t begin;
+        uint64_t end;
+} ws_range_t;
+
+typedef struct {
+        pool_t *pool;
+        int id;
+        pthread_t tid;
+        ws_range_t range;
+} ws_worker_t;
+
+struct pool {
+        int threads;
+        ws_worker_t *workers;
+
+        pthread_mutex_t mtx;
+        pthread_cond_t start_cv;
+        pthread_cond_t done_cv;
+        uint64_t generation;    /* číslo kola, ktoré sa má spracovať */
+        int idle;               /* koľko vlákien už dokončilo aktuálne kolo */
+        int stop;
+
+        pool_task_fn fn;
+        void *ctx;
+};
+
+/* zoberie úlohu zo začiatku vlastného rozsahu */
+static int take_own(ws_range_t *r, uint64_t *task)
+{
+        int ok = 0;
+
+        pthread_mutex_lock(&r->mtx);
+        if (r->begin < r->end) {
+                *task = r->begin++;
+                ok = 1;
+        }
+        pthread_mutex_unlock(&r->mtx);
+        return ok;
+}
+
+/* ukradne polovicu zvyšku od iného vlákna (nikdy nedrží dva zámky naraz) */
+static int steal(pool_t *p, int self)
+{
+        for (int k = 1; k < p->threads; k++) {
+                ws_range_t *victim = &p->workers[(self + k) % p->threads].range;
+                uint64_t from = 0, to = 0;
+
+                pthread_mutex_lock(&victim->mtx);
+                uint64_t left = victim->end - victim->begin;
+                if (victim->begin < victim->end) {
+                        to = victim->end;
+                        from = to - (left + 1) / 2;
+                        victim->end = from;
+                }
+                pthread_mutex_unlock(&victim->mtx);
+
+                if (from < to) {
+                        ws_range_t *own = &p->workers[self].range;
+                        pthread_mutex_lock(&own->mtx);
+                        own->begin = from;
+                        own->end = to;
+                        pthread_mutex_unlock(&own->mtx);
+                        return 1;
+                }
+        }
+        return 0;
+}
+
+/* hlavná slučka vlákna: čaká na kolo, spracuje úlohy, nahlási koniec */
+static void *worker_main(void *arg)
+{
+        ws_worker_t *w = (ws_worker_t *)arg;
+        pool_t *p = w->pool;
+        uint64_t seen = 0;
+
+        for (;;) {
+                pthread_mutex_lock(&p->mtx);
+                while (!p->stop && p->generation == seen)
+                        pthread_cond_wait(&p->start_cv, &p->mtx);
+                if (p->stop) {
+                        pthread_mutex_unlock(&p->mtx);
+                        break;
+                }
+                seen = p->generation;
+                pool_task_fn fn = p->fn;
+                void *ctx = p->ctx;
+                pthread_mutex_unlock(&p->mtx);
+
+                uint64_t task;
+                for (;;) {
+                        if (take_own(&w->range, &task)) {
+                                fn(ctx, w->id, task);
+                                continue;
+                        }
+                        if (!steal(p, w->id))
+                                break;
+                }
+
+                pthread_mutex_lock(&p->mtx);
+                p->idle++;
+                if (p->idle == p->threads)
+                        pthread_cond_signal(&p->done_cv);
+                pthread_mutex_unlock(&p->mtx);
+        }
+
+        return NULL;
+}
+
+pool_t *pool_create(int threads)
+{
+        if (threads <= 0) {
+                long n = sysconf(_SC_NPROCESSORS_ONLN);
+                threads = (n > 0) ? (int)n : 1;
+        }
+
+        pool_t *p = calloc(1, sizeof(*p));
+        if (!p)
+                return NULL;
+
+        p->workers = calloc((size_t)threads, sizeof(*p->workers));
+        if (!p->workers) {
+                free(p);
+                return NULL;
+        }
+
+        pthread_mutex_init(&p->mtx, NULL);
+        pthread_cond_init(&p->start_cv, NULL);
+        pthread_cond_init(&p->done_cv, NULL);
+
+        for (int i = 0; i < threads; i++) {
+                ws_worker_t *w = &p->workers[i];
+                w->pool = p;
+                w->id = i;
+                pthread_mutex_init(&w->range.mtx, NULL);
+
+                if (pthread_create(&w->tid, NULL, worker_main, w) != 0)
+                        break;
+                p->threads++;
+        }
+
+        if (p->threads == 0) {
+                pool_destroy(p);
+                return NULL;
+        }
+        return p;
+}
+
+int pool_threads(const pool_t *p)
+{
+        return p->threads;
+}
+
+void pool_run(pool_t *p, uint64_t ntasks, pool_task_fn fn, void *ctx)
+{
+        if (ntasks == 0)
+                return;
+
+        pthread_mutex_lock(&p->mtx);
+        p->fn = fn;
+        p->ctx = ctx;
+
+        /* na začiatku každé vlákno dostane súvislý kus, zvyšok vyrieši kradnutie */
+        uint64_t per = ntasks / (uint64_t)p->threads;
+        uint64_t extra = ntasks % (uint64_t)p->threads;
+        uint64_t pos = 0;
+        for (int i = 0; i < p->threads; i++) {
+                ws_range_t *r = &p->workers[i].range;
+                uint64_t n = per + ((uint64_t)i < extra ? 1 : 0);
+
+                pthread_mutex_lock(&r->mtx);
+                r->begin = pos;
+                r->end = pos + n;
+                pthread_mutex_unlock(&r->mtx);
+                pos += n;
+        }
+
+        p->idle = 0;
+        p->generation++;
+        pthread_cond_broadcast(&p->start_cv);
+
+        while (p->idle < p->threads)
+                pthread_cond_wait(&p->done_cv, &p->mtx);
+        pthread_mutex_unlock(&p->mtx);
+}
+
+void pool_destroy(pool_t *p)
+{
+        if (!p)
+                return;
+
+        pthread_mutex_lock(&p->mtx);
+        p->stop = 1;
+        pthread_cond_broadcast(&p->start_cv);
+        pthread_mutex_unlock(&p->mtx);
+
+        for (int i = 0; i < p->threads; i++)
+                pthread_join(p->workers[i].tid, NULL);
+
+        for (int i = 0; i < p->threads; i++)
+                pthread_mutex_destroy(&p->workers[i].range.mtx);
+        pthread_mutex_destroy(&p->mtx);
+        pthread_cond_destroy(&p->start_cv);
+        pthread_cond_destroy(&p->done_cv);
+
+        free(p->workers);
+        free(p);
+}
@@ -0,0 +1,31 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+#include <unistd.h>
+
+#include "rng.h"
+
+void rng_init(rng_t *r, uint64_t seed, uint64_t stream, uint64_t substream)
+{
+        /* zmiešame všetky tri kľúče, aby susedné prúdy nemali podobný stav */
+        uint64_t a = stream;
+        uint64_t b = substream ^ 0xD1B54A32D192ED03ULL;
+        uint64_t x = seed ^ rng_splitmix64(&a) ^ rng_rotl(rng_splitmix64(&b), 17);
+
+        for (int i = 0; i < 4; i++)
+                r->s[i] = rng_splitmix64(&x);
+
+        /* stav samé nuly je pre xoshiro zakázaný */
+        if ((r->s[0] | r->s[1] | r->s[2] | r->s[3]) == 0)
+                r->s[0] = 1;
+}
+
+uint64_t rng_random_seed(void)
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+
+        uint64_t x = ((uint64_t)ts.tv_sec << 32) ^ (uint64_t)ts.tv_nsec ^ ((uint64_t)getpid() << 16);
+        uint64_t seed = rng_splitmix64(&x);
+        return seed ? seed : 1;
+}
@@ -0,0 +1,462 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "shard.h"
+#include "grid.h"
+#include "bitmap.h"
+
+/* toľko rozsahov na jeden worker: padnutý worker stratí len malý kus práce */
+#define SHARD_SLICES_PER_WORKER 8
+
+/* koľkokrát môžu workery spolu padnúť, kým to master vzdá */
+#define SHARD_MAX_RESPAWNS 16
+
+/* úloha pre worker: replikácie [first_rep, first_rep + count), count 0 = koniec;
+   rovnaká hlavička ide späť pred počtami */
+typedef struct {
+        uint32_t first_rep;
+        uint32_t count;
+} shard_task_t;
+
+typedef struct {
+        pid_t pid;              /* 0 = worker nebeží */
+        int fd;                 /* strana mastera zo socketpair */
+        int task;               /* index rozpracovaného rozsahu, -1 = voľný */
+} shard_worker_t;
+
+/* stav jedného rozsahu replikácií */
+enum { SLICE_TODO, SLICE_RUNNING, SLICE_DONE };
+
+/* polia jedného výsledku (po riadkoch) */
+typedef struct {
+        uint64_t *hits;
+        uint64_t *steps_sum;
+        uint32_t *reps_used;
+        uint32_t *hist_hits;    /* NULL bez histogramu */
+        uint64_t *hist_steps;
+} shard_counts_t;
+
+static int write_full(int fd, const void *buf, size_t len)
+{
+        const uint8_t *bytes = (const uint8_t *)buf;
+        size_t sent = 0;
+
+        while (sent < len) {
+                ssize_t n = send(fd, bytes + sent, len - sent, MSG_NOSIGNAL);
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return -1;
+                }
+                if (n == 0)
+                        return -1;
+                sent += (size_t)n;
+        }
+        return 0;
+}
+
+/* 1 = OK, 0 = EOF, -1 = chyba */
+static int read_full(int fd, void *buf, size_t len)
+{
+        uint8_t *bytes = (uint8_t *)buf;
+        size_t got = 0;
+
+        while (got < len) {
+                ssize_t n = recv(fd, bytes + got, len - got, 0);
+                if (n < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return -1;
+                }
+                if (n == 0)
+                        return 0;
+                got += (size_t)n;
+        }
+        return 1;
+}
+
+static uint64_t elapsed_ms(const struct timespec *start)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)(now.tv_sec - start->tv_sec) * 1000u +
+               (uint64_t)((now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+static int counts_alloc(shard_counts_t *c, size_t total, size_t hist_n)
+{
+        memset(c, 0, sizeof(*c));
+        c->hits = malloc(total * sizeof(uint64_t));
+        c->steps_sum = malloc(total * sizeof(uint64_t));
+        c->reps_used = malloc(total * sizeof(uint32_t));
+        if (hist_n > 0) {
+                c->hist_hits = malloc(hist_n * sizeof(uint32_t));
+                c->hist_steps = malloc(hist_n * sizeof(uint64_t));
+        }
+        return (c->hits && c->steps_sum && c->reps_used &&
+                (hist_n == 0 || (c->hist_hits && c->hist_steps))) ? 0 : -1;
+}
+
+static void counts_free(shard_counts_t *c)
+{
+        free(c->hits);
+        free(c->steps_sum);
+        free(c->reps_used);
+        free(c->hist_hits);
+        free(c->hist_steps);
+}
+
+/* počty idú v poradí hits, steps_sum, reps_used, histogram */
+static int counts_io(int fd, shard_counts_t *c, size_t total, size_t hist_n, int send)
+{
+        void *parts[5] = {c->hits, c->steps_sum, c->reps_used, c->hist_hits, c->hist_steps};
+        size_t sizes[5] = {total * sizeof(uint64_t), total * sizeof(uint64_t), total * sizeof(uint32_t),
+                           hist_n * sizeof(uint32_t), hist_n * sizeof(uint64_t)};
+
+        for (int i = 0; i < 5; i++) {
+                if (sizes[i] == 0)
+                        continue;
+                if (send ? write_full(fd, parts[i], sizes[i]) != 0 : read_full(fd, parts[i], sizes[i]) != 1)
+                        return -1;
+        }
+        return 0;
+}
+
+/* worker dostane súvislý kus povolených CPU (susedné CPU bývajú v tom istom NUMA uzle);
+   vráti počet CPU v kuse, 0 ak ho nepripol */
+static int shard_pin(int index, int workers)
+{
+        cpu_set_t all;
+        if (sched_getaffinity(0, sizeof(all), &all) != 0)
+                return 0;
+
+        int n = CPU_COUNT(&all);
+        if (n < workers)
+                return 0;
+
+        int from = (int)((int64_t)index * n / workers);
+        int to = (int)((int64_t)(index + 1) * n / workers);
+
+        cpu_set_t mine;
+        CPU_ZERO(&mine);
+        for (int cpu = 0, k = 0; cpu < CPU_SETSIZE && k < to; cpu++) {
+                if (!CPU_ISSET(cpu, &all))
+                        continue;
+                if (k >= from)
+                        CPU_SET(cpu, &mine);
+                k++;
+        }
+
+        if (sched_setaffinity(0, sizeof(mine), &mine) != 0)
+                return 0;
+        return to - from;
+}
+
+/* telo procesu workera: počíta pridelené rozsahy, kým nepríde koniec alebo master nezmizne */
+static void shard_child(const engine_job_t *job, int index, int workers, int fd)
+{
+        /* zdedené sockety (klienti, ostatné workery) patria masterovi */
+        long max_fd = sysconf(_SC_OPEN_MAX);
+        if (max_fd < 0 || max_fd > 65536)
+                max_fd = 65536;
+        for (int f = 3; f < (int)max_fd; f++)
+                if (f != fd)
+                        close(f);
+
+        int cpus = shard_pin(index, workers);
+        int threads = job->threads > 0 ? job->threads / workers : cpus;
+        if (job->threads > 0 && threads < 1)
+                threads = 1;
+
+        /* worker počíta len čisté replikácie, o zvyšok sa stará master */
+        config cfg = *job->cfg;
+        cfg.deadline_sec = 0;
+        cfg.snapshot_reps = 0;
+        cfg.snapshot_ms = 0;
+        cfg.checkpoint_sec = 0;
+
+        size_t total = grid_cells(&cfg);
+        fpt_hist_t hist;
+        memset(&hist, 0, sizeof(hist));
+        if (job->hist && fpt_alloc(&hist, job->hist->cells, job->hist->origin, job->hist->max_steps, job->hist->width) != 0)
+                _exit(1);
+        size_t hist_n = (size_t)hist.cells * hist.buckets;
+
+        shard_counts_t c;
+        if (counts_alloc(&c, total, 0) != 0)
+                _exit(1);
+        c.hist_hits = hist.hits;
+        c.hist_steps = hist.steps;
+
+        for (;;) {
+                shard_task_t t;
+                if (read_full(fd, &t, sizeof(t)) != 1 || t.count == 0)
+                        break;
+
+                cfg.first_rep = t.first_rep;
+                cfg.replications = t.count;
+                memset(c.hits, 0, total * sizeof(uint64_t));
+                memset(c.steps_sum, 0, total * sizeof(uint64_t));
+                if (hist_n > 0) {
+                        memset(hist.hits, 0, hist_n * sizeof(uint32_t));
+                        memset(hist.steps, 0, hist_n * sizeof(uint64_t));
+                }
+
+                engine_job_t j;
+                memset(&j, 0, sizeof(j));
+                j.cfg = &cfg;
+                j.obstacles = job->obstacles;
+                j.nbr = job->nbr;
+                j.dist = job->dist;
+                j.hist = hist_n > 0 ? &hist : NULL;
+                j.seed = job->seed;
+                j.threads = threads;
+
+                /* pri chybe worker skončí a master rozsah pridelí inému */
+                if (engine_run(&j, c.hits, c.steps_sum, c.reps_used) != 0)
+                        _exit(1);
+                if (write_full(fd, &t, sizeof(t)) != 0 || counts_io(fd, &c, total, hist_n, 1) != 0)
+                        _exit(1);
+        }
+        _exit(0);
+}
+
+/* spustí worker na indexe i (0 ok, -1 pri chybe) */
+static int shard_spawn(const engine_job_t *job, shard_worker_t *w, int i, int workers)
+{
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+                return -1;
+
+        /* výstup mastera nech sa v dieťati nezopakuje */
+        fflush(stdout);
+
+        pid_t pid = fork();
+        if (pid < 0) {
+                close(sv[0]);
+                close(sv[1]);
+                return -1;
+        }
+        if (pid == 0)
+                shard_child(job, i, workers, sv[1]);
+
+        close(sv[1]);
+        w[i].pid = pid;
+        w[i].fd = sv[0];
+        w[i].task = -1;
+        return 0;
+}
+
+/* zastaví worker (po páde alebo na konci behu) */
+static void shard_reap(shard_worker_t *w, int kill_it)
+{
+        if (w->pid <= 0)
+                return;
+        if (kill_it)
+                kill(w->pid, SIGKILL);
+        close(w->fd);
+        waitpid(w->pid, NULL, 0);
+        w->pid = 0;
+        w->fd = -1;
+        w->task = -1;
+}
+
+/* priebežný stav pre on_snapshot: kópie v poradí tabuľky */
+static void shard_snapshot(const engine_job_t *job, const uint64_t *hits, const uint64_t *steps_sum,
+                           const uint32_t *reps_used, uint32_t reps_done, uint64_t active, size_t total)
+{
+        shard_counts_t c;
+        if (counts_alloc(&c, total, 0) == 0) {
+                memcpy(c.hits, hits, total * sizeof(uint64_t));
+                memcpy(c.steps_sum, steps_sum, total * sizeof(uint64_t));
+                memcpy(c.reps_used, reps_used, total * sizeof(uint32_t));
+                if (grid_nbr_permute(job->nbr, c.hits, sizeof(uint64_t)) == 0 &&
+                    grid_nbr_permute(job->nbr, c.steps_sum, sizeof(uint64_t)) == 0 &&
+                    grid_nbr_permute(job->nbr, c.reps_used, sizeof(uint32_t)) == 0)
+                        job->on_snapshot(job->user, c.hits, c.steps_sum, c.reps_used, reps_done, active);
+        }
+        counts_free(&c);
+}
+
+int shard_run(const engine_job_t *job, int workers, uint64_t *hits, uint64_t *steps_sum, uint32_t *reps_used)
+{
+        const config *cfg = job->cfg;
+        size_t total = grid_cells(cfg);
+        size_t hist_n = job->hist ? (size_t)job->hist->cells * job->hist->buckets : 0;
+
+        if (workers <= 0 || cfg->adaptive || job->resume)
+                return -1;
+
+        /* rozsahy replikácií; poradie dokončenia na výsledku nezáleží (sčítavajú sa celé čísla) */
+        uint32_t slice = (uint32_t)(((uint64_t)cfg->replications + (uint64_t)workers * SHARD_SLICES_PER_WORKER - 1) /
+                                    ((uint64_t)workers * SHARD_SLICES_PER_WORKER));
+        if (slice == 0)
+                slice = 1;
+        int nslices = (int)((cfg->replications + (uint64_t)slice - 1) / slice);
+
+        uint8_t *state = calloc((size_t)nslices, 1);
+        shard_worker_t *w = calloc((size_t)workers, sizeof(*w));
+        struct pollfd *pfd = calloc((size_t)workers, sizeof(*pfd));
+        shard_counts_t rx;
+        memset(&rx, 0, sizeof(rx));
+        if (!state || !w || !pfd || counts_alloc(&rx, total, hist_n) != 0) {
+                free(state);
+                free(w);
+                free(pfd);
+                counts_free(&rx);
+                return -1;
+        }
+
+        /* aktívne políčka len pre priebežný stav (rovnako ako engine bez adaptivity) */
+        uint64_t active = 0;
+        for (size_t row = 0; row < total; row++) {
+                uint32_t id = grid_nbr_id(job->nbr, (uint32_t)row);
+                if (id == job->nbr->origin || (job->obstacles && bitmap_get(job->obstacles, row)) ||
+                    (job->dist && job->dist[id] > cfg->max_steps))
+                        continue;
+                active++;
+        }
+
+        int alive = 0;
+        for (int i = 0; i < workers; i++) {
+                w[i].fd = -1;
+                w[i].task = -1;
+                if (shard_spawn(job, w, i, workers) == 0)
+                        alive++;
+        }
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        uint32_t reps_done = 0;
+        uint32_t snap_rep = 0;
+        uint64_t snap_ms = 0;
+        int done = 0;
+        int respawns = 0;
+        int stop = 0;
+
+        while (done < nslices && alive > 0) {
+                /* po uplynutí času už nič nové nepridelí, rozpracované dobehnú */
+                if (cfg->deadline_sec > 0 && elapsed_ms(&start) >= (uint64_t)cfg->deadline_sec * 1000u)
+                        stop = 1;
+
+                int next = 0;
+                int busy = 0;
+                for (int i = 0; i < workers; i++) {
+                        if (w[i].pid > 0 && w[i].task < 0 && !stop) {
+                                while (next < nslices && state[next] != SLICE_TODO)
+                                        next++;
+                                if (next < nslices) {
+                                        shard_task_t t;
+                                        t.first_rep = cfg->first_rep + (uint32_t)next * slice;
+                                        t.count = cfg->replications - (uint32_t)next * slice;
+                                        if (t.count > slice)
+                                                t.count = slice;
+
+                                        if (write_full(w[i].fd, &t, sizeof(t)) == 0) {
+                                                state[next] = SLICE_RUNNING;
+                                                w[i].task = next;
+                                        }
+                                }
+                        }
+
+                        pfd[i].fd = (w[i].pid > 0 && w[i].task >= 0) ? w[i].fd : -1;
+                        pfd[i].events = POLLIN;
+                        pfd[i].revents = 0;
+                        if (pfd[i].fd >= 0)
+                                busy++;
+                }
+                if (busy == 0)
+                        break;
+
+                /* pri deadline sa treba zobudiť aj bez výsledku */
+                int timeout = -1;
+                if (cfg->deadline_sec > 0 && !stop) {
+                        uint64_t left = (uint64_t)cfg->deadline_sec * 1000u - elapsed_ms(&start);
+                        timeout = left > 1000 ? 1000 : (int)left;
+                }
+                if (poll(pfd, (nfds_t)workers, timeout) < 0 && errno != EINTR)
+                        break;
+
+                for (int i = 0; i < workers; i++) {
+                        if (pfd[i].fd < 0 || pfd[i].revents == 0)
+                                continue;
+
+                        int task = w[i].task;
+                        shard_task_t t;
+                        if (read_full(w[i].fd, &t, sizeof(t)) != 1 ||
+                            t.first_rep != cfg->first_rep + (uint32_t)task * slice ||
+                            counts_io(w[i].fd, &rx, total, hist_n, 0) != 0) {
+                                /* worker padol: jeho rozsah ide späť do frontu a nahradí ho nový */
+                                printf("[SERVER] worker %d (pid %d) failed, reassigning replications from %u\n",
+                                        i, (int)w[i].pid, (unsigned)(cfg->first_rep + (uint32_t)task * slice));
+                                state[task] = SLICE_TODO;
+                                shard_reap(&w[i], 1);
+                                alive--;
+                                if (respawns < SHARD_MAX_RESPAWNS && shard_spawn(job, w, i, workers) == 0) {
+                                        respawns++;
+                                        alive++;
+                                }
+                                continue;
+                        }
+
+                        for (size_t k = 0; k < total; k++) {
+                                hits[k] += rx.hits[k];
+                                steps_sum[k] += rx.steps_sum[k];
+                                reps_used[k] += rx.reps_used[k];
+                        }
+                        for (size_t k = 0; k < hist_n; k++) {
+                                job->hist->hits[k] += rx.hist_hits[k];
+                                job->hist->steps[k] += rx.hist_steps[k];
+                        }
+
+                        state[task] = SLICE_DONE;
+                        w[i].task = -1;
+                        done++;
+                        reps_done += t.count;
+
+                        if (job->on_batch)
+                                job->on_batch(job->user, reps_done, active);
+
+                        uint64_t now_ms = elapsed_ms(&start);
+                        int due = (cfg->snapshot_reps > 0 && reps_done - snap_rep >= cfg->snapshot_reps) ||
+                                  (cfg->snapshot_ms > 0 && now_ms - snap_ms >= cfg->snapshot_ms);
+                        if (job->on_snapshot && due && done < nslices) {
+                                shard_snapshot(job, hits, steps_sum, reps_used, reps_done, active, total);
+                                snap_rep = reps_done;
+                                snap_ms = elapsed_ms(&start);
+                        }
+                }
+        }
+
+        /* koniec: voľné workery dostanú prázdnu úlohu, rozpracované (len pri chybe) sa zabijú */
+        for (int i = 0; i < workers; i++) {
+                if (w[i].pid <= 0)
+                        continue;
+                shard_task_t quit = {0, 0};
+                int busy = w[i].task >= 0;
+                if (!busy)
+                        write_full(w[i].fd, &quit, sizeof(quit));
+                shard_reap(&w[i], busy);
+        }
+
+        /* bez deadline musia byť hotové všetky rozsahy */
+        int rc = (done == nslices || stop) ? 0 : -1;
+
+        free(state);
+        free(w);
+        free(pfd);
+        counts_free(&rx);
+        return rc;
+}
@@ -0,0 +1,165 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shmres.h"
+#include "bitmap.h"
+
+/* polia v segmente začínajú na celých riadkoch cache */
+#define SHMRES_ALIGN 64
+
+static uint64_t align_up(uint64_t v)
+{
+        return (v + SHMRES_ALIGN - 1) & ~(uint64_t)(SHMRES_ALIGN - 1);
+}
+
+int shmres_create(shmres_t *r, uint32_t w, uint32_t h)
+{
+        static unsigned counter;
+        size_t cells = (size_t)w * h;
+
+        uint64_t obst_off = align_up(sizeof(msg_shm_hdr_t));
+        uint64_t sum_off = align_up(obst_off + bitmap_bytes(cells));
+        uint64_t len = sum_off + (uint64_t)cells * sizeof(msg_sum_cell_t);
+
+        r->fd = -1;
+        r->base = NULL;
+        r->len = 0;
+
+        char name[64];
+        int fd = -1;
+        for (int tries = 0; fd < 0 && tries < 16; tries++) {
+                snprintf(name, sizeof(name), "/sim_%d_%u", (int)getpid(), __atomic_fetch_add(&counter, 1, __ATOMIC_RELAXED));
+                fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        }
+        if (fd < 0)
+                return -1;
+        shm_unlink(name);
+
+        if (ftruncate(fd, (off_t)len) != 0) {
+                close(fd);
+                return -1;
+        }
+
+        void *base = mmap(NULL, (size_t)len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+                close(fd);
+                return -1;
+        }
+
+        /* ftruncate segment vynuluje, stačí hlavička */
+        msg_shm_hdr_t *hdr = (msg_shm_hdr_t *)base;
+        hdr->world_width = w;
+        hdr->world_height = h;
+        hdr->obstacles_off = obst_off;
+        hdr->summary_off = sum_off;
+        __atomic_store_n(&hdr->magic, MSG_SHM_MAGIC, __ATOMIC_RELEASE);
+
+        r->fd = fd;
+        r->base = (uint8_t *)base;
+        r->len = (size_t)len;
+        return 0;
+}
+
+/* zapíše pole do segmentu medzi dvoma zvýšeniami seq a zverejní novú generáciu */
+static uint64_t shmres_put(shmres_t *r, uint64_t off, uint64_t *len_field, const void *data, size_t len,
+                           uint32_t flag)
+{
+        msg_shm_hdr_t *hdr = (msg_shm_hdr_t *)r->base;
+        uint64_t seq = hdr->seq;
+
+        __atomic_store_n(&hdr->seq, seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        if (len > 0)
+                memcpy(r->base + off, data, len);
+        *len_field = len;
+        hdr->flags |= flag;
+        uint64_t gen = ++hdr->generation;
+
+        __atomic_store_n(&hdr->seq, seq + 2, __ATOMIC_RELEASE);
+        return gen;
+}
+
+uint64_t shmres_put_obstacles(shmres_t *r, const uint64_t *obstacles)
+{
+        msg_shm_hdr_t *hdr = (msg_shm_hdr_t *)r->base;
+        size_t cells = (size_t)hdr->world_width * hdr->world_height;
+        size_t len = obstacles ? bitmap_bytes(cells) : 0;
+
+        return shmres_put(r, hdr->obstacles_off, &hdr->obstacles_len, obstacles, len, MSG_SHM_HAS_OBSTACLES);
+}
+
+uint64_t shmres_put_summary(shmres_t *r, const msg_sum_cell_t *cells)
+{
+        msg_shm_hdr_t *hdr = (msg_shm_hdr_t *)r->base;
+        size_t len = (size_t)hdr->world_width * hdr->world_height * sizeof(msg_sum_cell_t);
+
+        return shmres_put(r, hdr->summary_off, &hdr->summary_len, cells, len, MSG_SHM_HAS_SUMMARY);
+}
+
+int shmres_attach(shmres_t *r, int fd)
+{
+        r->fd = -1;
+        r->base = NULL;
+        r->len = 0;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(msg_shm_hdr_t)) {
+                close(fd);
+                return -1;
+        }
+
+        void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+                close(fd);
+                return -1;
+        }
+
+        r->fd = fd;
+        r->base = (uint8_t *)base;
+        r->len = (size_t)st.st_size;
+        return 0;
+}
+
+int shmres_header(const shmres_t *r, msg_shm_hdr_t *out)
+{
+        const msg_shm_hdr_t *hdr = (const msg_shm_hdr_t *)r->base;
+        if (!hdr || __atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != MSG_SHM_MAGIC)
+                return -1;
+
+        /* seqlock: kópia platí, len ak sa seq medzitým nezmenilo a nebolo nepárne */
+        while (1) {
+                uint64_t seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+                if (seq & 1) {
+                        sched_yield();
+                        continue;
+                }
+                memcpy(out, (const void *)hdr, sizeof(*out));
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) == seq)
+                        break;
+        }
+
+        if (out->obstacles_off > r->len || out->obstacles_len > r->len - out->obstacles_off ||
+            out->summary_off > r->len || out->summary_len > r->len - out->summary_off)
+                return -1;
+        return 0;
+}
+
+void shmres_close(shmres_t *r)
+{
+        if (r->base)
+                munmap(r->base, r->len);
+        if (r->fd >= 0)
+                close(r->fd);
+        r->fd = -1;
+        r->base = NULL;
+        r->len = 0;
+}
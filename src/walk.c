@@ -0,0 +1,384 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "walk.h"
+#include "rng.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WALK_X86 1
+#endif
+
+typedef void (*walk_fn)(const walk_env_t *env, uint32_t rep, const int *cells, int n, uint32_t *hit_step);
+
+/* skalárne jadro: chodci idú jeden po druhom */
+static void walk_batch_scalar(const walk_env_t *env, uint32_t rep, const int *cells, int n, uint32_t *hit_step)
+{
+        const config *cfg = env->cfg;
+        const uint32_t *next = env->nbr->next;
+        const uint32_t *dist = env->dist;
+        uint32_t origin = env->nbr->origin;
+
+        for (int i = 0; i < n; i++) {
+                rng_t rng;
+                rng_init(&rng, env->seed, (uint64_t)rep + 1, grid_nbr_row(env->nbr, (uint32_t)cells[i]));
+
+                uint32_t id = (uint32_t)cells[i];
+
+                hit_step[i] = 0;
+                for (uint32_t steps = 1; steps <= cfg->max_steps; steps++) {
+                        int dir = grid_dir_of(&cfg->probs, rng_next01(&rng));
+                        id = next[4 * (size_t)id + (size_t)dir];
+
+                        if (id == origin) {
+                                hit_step[i] = steps;
+                                break;
+                        }
+
+                        /* zvyšok krokov nestačí ani na najkratšiu cestu */
+                        if (dist && dist[id] > cfg->max_steps - steps)
+                                break;
+                }
+        }
+}
+
+/* skalárne jadro s makro-krokmi: ďaleko od cieľa a prekážok skáče o m krokov naraz;
+   spotreba náhodných čísel je iná ako pri krokovaní, rozdelenie výsledkov rovnaké */
+static void walk_batch_jump(const walk_env_t *env, uint32_t rep, const int *cells, int n, uint32_t *hit_step)
+{
+        const config *cfg = env->cfg;
+        const uint32_t *next = env->nbr->next;
+        const uint32_t *dist = env->dist;
+        const uint8_t *clear = env->clear;
+        const jump_table_t *jt = env->jump;
+        uint32_t origin = env->nbr->origin;
+        uint32_t w = (uint32_t)env->nbr->width;
+        uint32_t h = (uint32_t)env->nbr->height;
+        uint32_t K = cfg->max_steps;
+
+        for (int i = 0; i < n; i++) {
+                rng_t rng;
+                rng_init(&rng, env->seed, (uint64_t)rep + 1, grid_nbr_row(env->nbr, (uint32_t)cells[i]));
+
+                uint32_t id = (uint32_t)cells[i];
+                uint32_t steps = 0;
+
+                hit_step[i] = 0;
+                while (steps < K) {
+                        int l = jump_level_for(jt, clear[id], K - steps);
+
+                        if (l >= 0) {
+                                /* počas skoku sa nedá trafiť cieľ ani naraziť do prekážky */
+                                const jump_level_t *lv = &jt->lv[l];
+                                uint32_t k = jump_sample(lv, &rng);
+                                uint32_t at = grid_nbr_row(env->nbr, id);
+                                uint32_t row = at / w;
+                                int32_t r = (int32_t)row + lv->drow[k];
+                                int32_t c = (int32_t)(at - row * w) + lv->dcol[k];
+
+                                /* posun je najviac 32, v úzkom svete môže obísť aj viackrát */
+                                while (r < 0)
+                                        r += (int32_t)h;
+                                while (r >= (int32_t)h)
+                                        r -= (int32_t)h;
+                                while (c < 0)
+                                        c += (int32_t)w;
+                                while (c >= (int32_t)w)
+                                        c -= (int32_t)w;
+                                id = grid_nbr_id(env->nbr, (uint32_t)r * w + (uint32_t)c);
+                                steps += lv->m;
+                        } else {
+                                int dir = grid_dir_of(&cfg->probs, rng_next01(&rng));
+                                id = next[4 * (size_t)id + (size_t)dir];
+                                steps++;
+
+                                if (id == origin) {
+                                        hit_step[i] = steps;
+                                        break;
+                                }
+                        }
+
+                        if (dist && dist[id] > K - steps)
+                                break;
+                }
+        }
+}
+
+#ifdef WALK_X86
+
+/* stav pruhov vektorového jadra v tvare SoA (jeden prvok = jeden chodec) */
+typedef struct {
+        int64_t pos[8];             /* index políčka */
+        int64_t steps[8];
+        int64_t active[8];          /* -1 = pruh má chodca, 0 = prázdny */
+        uint64_t s[4][8];           /* stav xoshiro256++ po pruhoch */
+        int walker[8];              /* index do cells[] */
+} walk_lanes_t;
+
+/* do pruhu dá ďalšieho chodca z fronty (alebo ho vypne) */
+static void lane_refill(const walk_env_t *env, uint32_t rep, const int *cells, int n, int *next,
+                        walk_lanes_t *L, int lane)
+{
+        if (*next >= n) {
+                /* prázdny pruh stojí na [0,0], aby čítal z platného indexu */
+                L->active[lane] = 0;
+                L->pos[lane] = env->nbr->origin;
+                L->steps[lane] = 0;
+                L->walker[lane] = -1;
+                return;
+        }
+
+        int i = (*next)++;
+
+        rng_t rng;
+        rng_init(&rng, env->seed, (uint64_t)rep + 1, grid_nbr_row(env->nbr, (uint32_t)cells[i]));
+
+        L->active[lane] = -1;
+        L->pos[lane] = cells[i];
+        L->steps[lane] = 0;
+        L->walker[lane] = i;
+        for (int k = 0; k < 4; k++)
+                L->s[k][lane] = rng.s[k];
+}
+
+/* zapíše výsledky skončených pruhov a doplní ich novými chodcami */
+static void lanes_retire(const walk_env_t *env, uint32_t rep, const int *cells, int n, int *next,
+                         walk_lanes_t *L, int lanes, unsigned hit_bits, unsigned fin_bits, uint32_t *hit_step)
+{
+        for (int l = 0; l < lanes; l++) {
+                if (!(fin_bits & (1u << l)))
+                        continue;
+                hit_step[L->walker[l]] = (hit_bits & (1u << l)) ? (uint32_t)L->steps[l] : 0;
+                lane_refill(env, rep, cells, n, next, L, l);
+        }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i rotl_avx2(__m256i x, int k)
+{
+        return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+}
+
+/* AVX2: 4 chodci naraz v 64-bitových pruhoch, skončený pruh sa hneď doplní */
+__attribute__((target("avx2")))
+static void walk_batch_avx2(const walk_env_t *env, uint32_t rep, const int *cells, int n, uint32_t *hit_step)
+{
+        const config *cfg = env->cfg;
+        const int *table = (const int *)(const void *)env->nbr->next;
+
+        walk_lanes_t L;
+        int next = 0;
+        for (int l = 0; l < 4; l++)
+                lane_refill(env, rep, cells, n, &next, &L, l);
+
+        const __m256d va = _mm256_set1_pd(cfg->probs.p_up);
+        const __m256d vb = _mm256_set1_pd(cfg->probs.p_up + cfg->probs.p_down);
+        const __m256d vc = _mm256_set1_pd(cfg->probs.p_up + cfg->probs.p_down + cfg->probs.p_left);
+        const __m256i one_bits = _mm256_set1_epi64x(0x3FF0000000000000LL);
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256i v3 = _mm256_set1_epi64x(3);
+        const __m256i vorigin = _mm256_set1_epi64x((long long)env->nbr->origin);
+        const __m256i vk = _mm256_set1_epi64x((long long)cfg->max_steps);
+        const int *dist = (const int *)(const void *)env->dist;
+
+        while (next < n || L.active[0] || L.active[1] || L.active[2] || L.active[3]) {
+                __m256i pos = _mm256_loadu_si256((const __m256i *)L.pos);
+                __m256i steps = _mm256_loadu_si256((const __m256i *)L.steps);
+                __m256i active = _mm256_loadu_si256((const __m256i *)L.active);
+                __m256i s0 = _mm256_loadu_si256((const __m256i *)L.s[0]);
+                __m256i s1 = _mm256_loadu_si256((const __m256i *)L.s[1]);
+                __m256i s2 = _mm256_loadu_si256((const __m256i *)L.s[2]);
+                __m256i s3 = _mm256_loadu_si256((const __m256i *)L.s[3]);
+
+                __m256i hit, fin;
+
+                /* kroky, kým niektorý pruh neskončí */
+                for (;;) {
+                        /* xoshiro256++ */
+                        __m256i res = _mm256_add_epi64(rotl_avx2(_mm256_add_epi64(s0, s3), 23), s0);
+                        __m256i t = _mm256_slli_epi64(s1, 17);
+                        s2 = _mm256_xor_si256(s2, s0);
+                        s3 = _mm256_xor_si256(s3, s1);
+                        s1 = _mm256_xor_si256(s1, s2);
+                        s0 = _mm256_xor_si256(s0, s3);
+                        s2 = _mm256_xor_si256(s2, t);
+                        s3 = rotl_avx2(s3, 45);
+
+                        /* rovnaké <0,1) ako rng_next01 */
+                        __m256d r = _mm256_sub_pd(_mm256_castsi256_pd(
+                                _mm256_or_si256(_mm256_srli_epi64(res, 12), one_bits)), one);
+
+                        /* smer = 3 + lt_a + lt_b + lt_c (masky sú -1), rovnako ako grid_dir_of */
+                        __m256i lt_a = _mm256_castpd_si256(_mm256_cmp_pd(r, va, _CMP_LT_OQ));
+                        __m256i lt_b = _mm256_castpd_si256(_mm256_cmp_pd(r, vb, _CMP_LT_OQ));
+                        __m256i lt_c = _mm256_castpd_si256(_mm256_cmp_pd(r, vc, _CMP_LT_OQ));
+                        __m256i dir = _mm256_add_epi64(_mm256_add_epi64(v3, lt_a), _mm256_add_epi64(lt_b, lt_c));
+
+                        /* nový index z tabuľky susedov */
+                        __m256i slot = _mm256_add_epi64(_mm256_slli_epi64(pos, 2), dir);
+                        __m256i npos = _mm256_cvtepu32_epi64(_mm256_i64gather_epi32(table, slot, 4));
+
+                        pos = _mm256_blendv_epi8(pos, npos, active);
+                        steps = _mm256_sub_epi64(steps, active);
+
+                        hit = _mm256_and_si256(active, _mm256_cmpeq_epi64(pos, vorigin));
+                        __m256i out = _mm256_cmpeq_epi64(steps, vk);
+
+                        /* koniec aj vtedy, keď steps + dist > K (už nemôže trafiť) */
+                        if (dist) {
+                                __m256i d = _mm256_cvtepu32_epi64(_mm256_i64gather_epi32(dist, pos, 4));
+                                out = _mm256_or_si256(out, _mm256_cmpgt_epi64(_mm256_add_epi64(steps, d), vk));
+                        }
+                        fin = _mm256_or_si256(hit, _mm256_and_si256(active, out));
+
+                        if (!_mm256_testz_si256(fin, fin))
+                                break;
+                }
+
+                _mm256_storeu_si256((__m256i *)L.pos, pos);
+                _mm256_storeu_si256((__m256i *)L.steps, steps);
+                _mm256_storeu_si256((__m256i *)L.s[0], s0);
+                _mm256_storeu_si256((__m256i *)L.s[1], s1);
+                _mm256_storeu_si256((__m256i *)L.s[2], s2);
+                _mm256_storeu_si256((__m256i *)L.s[3], s3);
+
+                unsigned hit_bits = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(hit));
+                unsigned fin_bits = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(fin));
+                lanes_retire(env, rep, cells, n, &next, &L, 4, hit_bits, fin_bits, hit_step);
+        }
+}
+
+/* AVX-512: 8 chodcov naraz, pruhy sa maskujú priamo cez __mmask8 */
+__attribute__((target("avx512f")))
+static void walk_batch_avx512(const walk_env_t *env, uint32_t rep, const int *cells, int n, uint32_t *hit_step)
+{
+        const config *cfg = env->cfg;
+        const void *table = (const void *)env->nbr->next;
+
+        walk_lanes_t L;
+        int next = 0;
+        for (int l = 0; l < 8; l++)
+                lane_refill(env, rep, cells, n, &next, &L, l);
+
+        const __m512d va = _mm512_set1_pd(cfg->probs.p_up);
+        const __m512d vb = _mm512_set1_pd(cfg->probs.p_up + cfg->probs.p_down);
+        const __m512d vc = _mm512_set1_pd(cfg->probs.p_up + cfg->probs.p_down + cfg->probs.p_left);
+        const __m512i one_bits = _mm512_set1_epi64(0x3FF0000000000000LL);
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512i v1 = _mm512_set1_epi64(1);
+        const __m512i vorigin = _mm512_set1_epi64((long long)env->nbr->origin);
+        const __m512i vk = _mm512_set1_epi64((long long)cfg->max_steps);
+        const void *dist = (const void *)env->dist;
+
+        for (;;) {
+                __mmask8 active = 0;
+                for (int l = 0; l < 8; l++)
+                        if (L.active[l])
+                                active |= (__mmask8)(1u << l);
+                if (!active)
+                        break;
+
+                __m512i pos = _mm512_loadu_si512(L.pos);
+                __m512i steps = _mm512_loadu_si512(L.steps);
+                __m512i s0 = _mm512_loadu_si512(L.s[0]);
+                __m512i s1 = _mm512_loadu_si512(L.s[1]);
+                __m512i s2 = _mm512_loadu_si512(L.s[2]);
+                __m512i s3 = _mm512_loadu_si512(L.s[3]);
+
+                __mmask8 hit, fin;
+
+                for (;;) {
+                        __m512i res = _mm512_add_epi64(_mm512_rol_epi64(_mm512_add_epi64(s0, s3), 23), s0);
+                        __m512i t = _mm512_slli_epi64(s1, 17);
+                        s2 = _mm512_xor_si512(s2, s0);
+                        s3 = _mm512_xor_si512(s3, s1);
+                        s1 = _mm512_xor_si512(s1, s2);
+                        s0 = _mm512_xor_si512(s0, s3);
+                        s2 = _mm512_xor_si512(s2, t);
+                        s3 = _mm512_rol_epi64(s3, 45);
+
+                        __m512d r = _mm512_sub_pd(_mm512_castsi512_pd(
+                                _mm512_or_si512(_mm512_srli_epi64(res, 12), one_bits)), one);
+
+                        /* smer = 3 - (počet splnených porovnaní) */
+                        __mmask8 lt_a = _mm512_cmp_pd_mask(r, va, _CMP_LT_OQ);
+                        __mmask8 lt_b = _mm512_cmp_pd_mask(r, vb, _CMP_LT_OQ);
+                        __mmask8 lt_c = _mm512_cmp_pd_mask(r, vc, _CMP_LT_OQ);
+                        __m512i slot = _mm512_slli_epi64(pos, 2);
+                        slot = _mm512_add_epi64(slot, _mm512_set1_epi64(3));
+                        slot = _mm512_mask_sub_epi64(slot, lt_a, slot, v1);
+                        slot = _mm512_mask_sub_epi64(slot, lt_b, slot, v1);
+                        slot = _mm512_mask_sub_epi64(slot, lt_c, slot, v1);
+
+                        __m512i npos = _mm512_cvtepu32_epi64(
+                                _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), active, slot, table, 4));
+
+                        pos = _mm512_mask_mov_epi64(pos, active, npos);
+                        steps = _mm512_mask_add_epi64(steps, active, steps, v1);
+
+                        hit = active & _mm512_cmpeq_epi64_mask(pos, vorigin);
+                        __mmask8 out = _mm512_cmpeq_epi64_mask(steps, vk);
+
+                        /* koniec aj vtedy, keď steps + dist > K (už nemôže trafiť) */
+                        if (dist) {
+                                __m512i d = _mm512_cvtepu32_epi64(
+                                        _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), active, pos, dist, 4));
+                                out |= _mm512_cmpgt_epi64_mask(_mm512_add_epi64(steps, d), vk);
+                        }
+                        fin = hit | (active & out);
+
+                        if (fin)
+                                break;
+                }
+
+                _mm512_storeu_si512(L.pos, pos);
+                _mm512_storeu_si512(L.steps, steps);
+                _mm512_storeu_si512(L.s[0], s0);
+                _mm512_storeu_si512(L.s[1], s1);
+                _mm512_storeu_si512(L.s[2], s2);
+                _mm512_storeu_si512(L.s[3], s3);
+
+                lanes_retire(env, rep, cells, n, &next, &L, 8, hit, fin, hit_step);
+        }
+}
+
+#endif
+
+static walk_fn walk_impl = walk_batch_scalar;
+static const char *walk_name = "scalar";
+static pthread_once_t walk_once = PTHREAD_ONCE_INIT;
+
+/* výber jadra podľa CPU */
+static void walk_select(void)
+{
+#ifdef WALK_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+                walk_impl = walk_batch_avx512;
+                walk_name = "avx512";
+        } else if (__builtin_cpu_supports("avx2")) {
+                walk_impl = walk_batch_avx2;
+                walk_name = "avx2";
+        }
+#endif
+}
+
+void walk_batch(const walk_env_t *env, uint32_t rep, const int *cells, int n, uint32_t *hit_step)
+{
+        if (env->jump) {
+                walk_batch_jump(env, rep, cells, n, hit_step);
+                return;
+        }
+
+        pthread_once(&walk_once, walk_select);
+        walk_impl(env, rep, cells, n, hit_step);
+}
+
+const char *walk_kernel_name(void)
+{
+        pthread_once(&walk_once, walk_select);
+        return walk_name;
+}